@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "Tablebase.h"
+#include "Tablebase_gen.h"
+
+using namespace std;
+
+// Битовые базы: выигрыш / ничья / проигрыш ходящего для всех позиций до Pieces фигур, 2 бита на позицию
+// (около 2 МБ), целиком в памяти — проверка без обращений к диску и блокировок.
+// Номера позиций и классы материала те же, что у файловых баз (Tablebase.h), значения строит тот же
+// генератор (Tablebase_gen.h) по генератору ходов Logic, поэтому базы покрывают всё, что допускают правила
+// игры: дамки на всю диагональ, превращение посреди взятия, обязательное взятие.
+// Расстояний до конца в базах нет, но для каждого класса материала хранится самый долгий выигрыш или
+// проигрыш в полуходах (по генератору) — поиск не полагается на выигрыш, который может не успеть к ничьей.
+// Базы загружаются из файла path; если его нет или он не подходит, при первом поиске (prepare) они строятся
+// в фоновом потоке (около минуты на одном ядре) и сохраняются в path. До готовности probe() отвечает false.
+class Bitbase
+{
+  public:
+    static const int Pieces = 4;
+
+    // Значения позиций в базе
+    static const uint8_t DRAW = 0, WIN = 1, LOSS = 2, INVALID = 3;
+
+    explicit Bitbase(const string &path) : path(path)
+    {
+        uint64_t total = 0;
+        for (const auto &m : Tb_material::classes(Pieces))
+        {
+            offset[id(m)] = total;
+            total += m.size();
+        }
+        bits.assign((total + 31) / 32, 0);
+        if (load())
+            ready.store(true, memory_order_release);
+    }
+
+    Bitbase(const Bitbase &) = delete;
+    Bitbase &operator=(const Bitbase &) = delete;
+
+    ~Bitbase()
+    {
+        stop.store(true);
+        if (builder.joinable())
+            builder.join();
+    }
+
+    // Запускает построение в фоне, если база не загружена (один раз). logic — копия генератора ходов
+    // для фонового потока; в ней не должно быть ссылки на эту базу.
+    template <class Move_gen> void prepare(const Move_gen &logic)
+    {
+        call_once(started, [&] {
+            if (ready.load(memory_order_acquire))
+                return;
+            builder = thread([this, logic]() { build(logic); });
+        });
+    }
+
+    bool is_ready() const
+    {
+        return ready.load(memory_order_acquire);
+    }
+
+    // Значение (DRAW / WIN / LOSS) позиции pos с ходом белых и самый долгий выигрыш или проигрыш
+    // её класса в полуходах (plies); false, если база не готова или в позиции больше Pieces фигур
+    // либо у одной из сторон их нет
+    bool probe(const Packed_position &pos, uint8_t &value, int &plies) const
+    {
+        if (!is_ready())
+            return false;
+        const Tb_material m = Tb_material::of(pos);
+        if (m.pieces() > Pieces || m.wm + m.wk == 0 || m.bm + m.bk == 0)
+            return false;
+        value = get(offset[id(m)] + m.index(pos));
+        plies = longest[id(m)];
+        return true;
+    }
+
+    // Значение позиции mtx, где ходит color (0 — белые), с точки зрения ходящего
+    bool probe(const vector<vector<POS_T>> &mtx, const bool color, uint8_t &value, int &plies) const
+    {
+        const Packed_position pos = pack(mtx);
+        return probe(canonical(pos, color), value, plies);
+    }
+
+    // То же без длины выигрыша (решателю она не нужна)
+    bool probe(const vector<vector<POS_T>> &mtx, const bool color, uint8_t &value) const
+    {
+        int plies;
+        return probe(mtx, color, value, plies);
+    }
+
+  private:
+    template <class Move_gen> void build(const Move_gen &logic)
+    {
+        // Половина ядер: остальные остаются поиску, который идёт одновременно
+        Tablebase_generator<Move_gen> gen(logic, max(1u, thread::hardware_concurrency() / 2), &stop);
+        for (const auto &m : Tb_material::classes(Pieces))
+        {
+            if (!gen.solve(m))
+                return;
+            const auto &values = gen.values(m);
+            for (uint64_t idx = 0; idx < values.size(); ++idx)
+            {
+                const uint8_t v = values[idx];
+                if (v >= 2)
+                    longest[id(m)] = max<uint8_t>(longest[id(m)], uint8_t(Tb::distance(v)));
+                set(offset[id(m)] + idx, v == Tb::INVALID ? INVALID
+                                         : Tb::is_win(v)  ? WIN
+                                         : Tb::is_loss(v) ? LOSS
+                                                          : DRAW);
+            }
+        }
+        save();
+        ready.store(true, memory_order_release);
+    }
+
+    // Файл: "CKBB", uint32 версия, uint32 число фигур, uint64 число слов, таблица longest, затем слова
+    // (little-endian). Версия меняется вместе с форматом и правилами генератора ходов — старый файл
+    // тогда строится заново.
+    static const uint32_t Version = 2;
+
+    bool load()
+    {
+        ifstream fin(path, ios::binary);
+        char magic[4];
+        uint32_t version = 0, pieces = 0;
+        uint64_t words = 0;
+        if (!fin.read(magic, 4) || memcmp(magic, "CKBB", 4) != 0)
+            return false;
+        fin.read(reinterpret_cast<char *>(&version), sizeof(version));
+        fin.read(reinterpret_cast<char *>(&pieces), sizeof(pieces));
+        fin.read(reinterpret_cast<char *>(&words), sizeof(words));
+        if (!fin || version != Version || pieces != uint32_t(Pieces) || words != bits.size())
+            return false;
+        fin.read(reinterpret_cast<char *>(longest), sizeof(longest));
+        return bool(fin.read(reinterpret_cast<char *>(bits.data()), bits.size() * sizeof(uint64_t)));
+    }
+
+    void save() const
+    {
+        ofstream fout(path, ios::binary | ios::trunc);
+        const uint32_t version = Version, pieces = Pieces;
+        const uint64_t words = bits.size();
+        fout.write("CKBB", 4);
+        fout.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        fout.write(reinterpret_cast<const char *>(&pieces), sizeof(pieces));
+        fout.write(reinterpret_cast<const char *>(&words), sizeof(words));
+        fout.write(reinterpret_cast<const char *>(longest), sizeof(longest));
+        fout.write(reinterpret_cast<const char *>(bits.data()), bits.size() * sizeof(uint64_t));
+    }
+
+    uint8_t get(const uint64_t i) const
+    {
+        return uint8_t(bits[i / 32] >> (i % 32 * 2) & 3);
+    }
+
+    void set(const uint64_t i, const uint8_t v)
+    {
+        bits[i / 32] |= uint64_t(v) << (i % 32 * 2);
+    }
+
+    static int id(const Tb_material &m)
+    {
+        return ((m.wm * (Pieces + 1) + m.wk) * (Pieces + 1) + m.bm) * (Pieces + 1) + m.bk;
+    }
+
+    string path;
+    // Начало класса материала в общей нумерации (по id)
+    uint64_t offset[(Pieces + 1) * (Pieces + 1) * (Pieces + 1) * (Pieces + 1)] = {};
+    // Самый долгий выигрыш или проигрыш класса в полуходах (по id)
+    uint8_t longest[(Pieces + 1) * (Pieces + 1) * (Pieces + 1) * (Pieces + 1)] = {};
+    vector<uint64_t> bits;
+
+    atomic<bool> ready{false}, stop{false};
+    once_flag started;
+    thread builder;
+};
@@ -168,6 +168,26 @@ public:
         return mtx;
     }
 
+    // Начальная расстановка: чёрные шашки в верхних трёх рядах, белые — в нижних трёх
+    static vector<vector<POS_T>> start_mtx()
+    {
+        vector<vector<POS_T>> res(8, vector<POS_T>(8, 0));
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                // Расстановка черных шашек (верхние 3 ряда)
+                if (i < 3 && (i + j) % 2 == 1)
+                    res[i][j] = 2;
+
+                // Расстановка белых шашек (нижние 3 ряда)
+                if (i > 4 && (i + j) % 2 == 1)
+                    res[i][j] = 1;
+            }
+        }
+        return res;
+    }
+
     // Подсветка указанных клеток (для показа возможных ходов)
     void highlight_cells(vector<pair<POS_T, POS_T>> cells)
     {
@@ -284,22 +304,7 @@ private:
     // Создание начальной расстановки шашек
     void make_start_mtx()
     {
-        // Инициализация матрицы 8x8 нулями
-        for (POS_T i = 0; i < 8; ++i)
-        {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                mtx[i][j] = 0;  // Пустая клетка
-                
-                // Расстановка черных шашек (верхние 3 ряда)
-                if (i < 3 && (i + j) % 2 == 1)
-                    mtx[i][j] = 2;
-                
-                // Расстановка белых шашек (нижние 3 ряда)
-                if (i > 4 && (i + j) % 2 == 1)
-                    mtx[i][j] = 1;
-            }
-        }
+        mtx = start_mtx();
         add_history();  // Сохранение начальной позиции в истории
     }
 
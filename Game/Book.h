@@ -0,0 +1,134 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Models/Mapped_file.h"
+
+using namespace std;
+
+// Ход книги: ключ позиции до хода, ключ позиции после хода (вся цепочка взятий) и вес хода.
+// Ключи — Zobrist::canonical_key(доска, сторона, которая ходит): таблица Зобриста постоянна, поэтому ключи
+// одинаковы от запуска к запуску, а позиция и её отражение с обменом цветов — одна запись книги.
+// Ход задан позицией после него, поэтому цепочки взятий с одинаковым началом различаются, а книге
+// не нужна своя запись ходов.
+struct Book_entry
+{
+    uint64_t key = 0;
+    uint64_t next_key = 0;
+    uint32_t weight = 0;
+
+    bool operator<(const Book_entry &o) const
+    {
+        if (key != o.key)
+            return key < o.key;
+        return next_key < o.next_key;
+    }
+};
+
+// Дебютная книга. Файл (little-endian): "CKBK", uint32 версия (2), uint64 число ходов, затем ходы
+// по 20 байт (uint64 key, uint64 next_key, uint32 weight), отсортированные по key и next_key.
+// Файл отображается в память (Mapped_file) — открытие ничего не читает, поиск позиции — двоичный
+// поиск по отображённым записям, с диска подгружаются только затронутые страницы.
+class Book
+{
+  public:
+    static const uint32_t Version = 2;
+    static const size_t Header_size = 16, Entry_size = 20;
+
+    // Открывает книгу path; false, если файла нет или формат не совпадает
+    bool open(const string &path)
+    {
+        count = 0;
+        if (!file.open(path) || file.size() < Header_size)
+            return false;
+        uint32_t version = 0;
+        uint64_t n = 0;
+        memcpy(&version, file.data() + 4, 4);
+        memcpy(&n, file.data() + 8, 8);
+        if (memcmp(file.data(), "CKBK", 4) != 0 || version != Version ||
+            file.size() != Header_size + n * Entry_size)
+            return false;
+        count = n;
+        return true;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    uint64_t size() const
+    {
+        return count;
+    }
+
+    // Ходы книги из позиции с ключом key
+    vector<Book_entry> moves(const uint64_t key) const
+    {
+        // Первая запись с ключом не меньше key
+        uint64_t lo = 0, hi = count;
+        while (lo < hi)
+        {
+            const uint64_t mid = (lo + hi) / 2;
+            if (entry(mid).key < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        vector<Book_entry> res;
+        for (; lo < count; ++lo)
+        {
+            const Book_entry e = entry(lo);
+            if (e.key != key)
+                break;
+            res.push_back(e);
+        }
+        return res;
+    }
+
+    // Записывает книгу из ходов entries: одинаковые ходы объединяются (веса складываются)
+    static bool save(const string &path, vector<Book_entry> entries)
+    {
+        sort(entries.begin(), entries.end());
+        vector<Book_entry> merged;
+        for (const auto &e : entries)
+        {
+            if (!merged.empty() && merged.back().key == e.key && merged.back().next_key == e.next_key)
+                merged.back().weight += e.weight;
+            else
+                merged.push_back(e);
+        }
+
+        ofstream fout(path, ios::binary | ios::trunc);
+        const uint32_t version = Version;
+        const uint64_t n = merged.size();
+        fout.write("CKBK", 4);
+        fout.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        fout.write(reinterpret_cast<const char *>(&n), sizeof(n));
+        for (const auto &e : merged)
+        {
+            fout.write(reinterpret_cast<const char *>(&e.key), sizeof(e.key));
+            fout.write(reinterpret_cast<const char *>(&e.next_key), sizeof(e.next_key));
+            fout.write(reinterpret_cast<const char *>(&e.weight), sizeof(e.weight));
+        }
+        return bool(fout);
+    }
+
+  private:
+    Book_entry entry(const uint64_t k) const
+    {
+        const uint8_t *p = file.data() + Header_size + k * Entry_size;
+        Book_entry e;
+        memcpy(&e.key, p, 8);
+        memcpy(&e.next_key, p + 8, 8);
+        memcpy(&e.weight, p + 16, 4);
+        return e;
+    }
+
+    Mapped_file file;
+    uint64_t count = 0;
+};
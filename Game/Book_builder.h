@@ -0,0 +1,280 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "Board.h"
+#include "Book.h"
+#include "Hash.h"
+#include "Notation.h"
+
+using namespace std;
+
+// Статистика хода книги: позиция до хода (канонический ключ и каноническая форма — с ходом белых,
+// для проверки поиском), канонический ключ позиции после хода и исходы партий, в которых ход сделан,
+// с точки зрения сделавшего его.
+struct Book_record
+{
+    uint64_t key = 0;
+    uint64_t next_key = 0;
+    Packed_position pos;
+    uint32_t games = 0, wins = 0, draws = 0, losses = 0;
+
+    bool same_move(const Book_record &o) const
+    {
+        return key == o.key && next_key == o.next_key;
+    }
+
+    bool operator<(const Book_record &o) const
+    {
+        if (key != o.key)
+            return key < o.key;
+        return next_key < o.next_key;
+    }
+
+    void add(const Book_record &o)
+    {
+        games += o.games;
+        wins += o.wins;
+        draws += o.draws;
+        losses += o.losses;
+    }
+
+    // Вес хода в книге — очки хода (2 за победу, 1 за ничью): частые и удачные ходы играются чаще,
+    // ход, который только проигрывал, не играется совсем
+    uint32_t weight() const
+    {
+        return 2 * wins + draws;
+    }
+};
+
+// Построитель дебютной книги из записей партий.
+// Move_gen — генератор ходов Logic (find_full_turns, make_turn), как у Tablebase_generator.
+//
+// Партии читаются потоком (add_games), из каждой берутся первые max_plies полуходов. Статистика ходов
+// копится в буфере размером buffer_mb; заполненный буфер сортируется, одинаковые ходы сливаются,
+// и он уходит на диск отдельным отсортированным прогоном (файлы "<temp>.run<N>"). merge() сливает
+// прогоны многопутевым слиянием и отбрасывает редкие ходы — в памяти одновременно только буфер
+// и по одной записи каждого прогона, поэтому число партий ограничено лишь диском.
+//
+// Формат записей: ходы как в Notation::move_string ("c3-d4", "c3:e5:g3", взятие можно записать и
+// через "x" или только начальной и конечной клетками), разделённые пробелами или переводами строк;
+// партия заканчивается результатом "1-0", "0-1" или "1/2-1/2" (также "2-0", "0-2", "1-1", "*" —
+// результат неизвестен, партия не учитывается). Номера ходов ("12."), теги PDN в квадратных скобках
+// и комментарии в фигурных пропускаются. Все партии начинаются с начальной расстановки.
+template <class Move_gen> class Book_builder
+{
+  public:
+    Book_builder(Move_gen &logic, const string &temp, const size_t buffer_mb, const int max_plies)
+        : logic(logic), temp(temp), max_plies(max_plies),
+          capacity(max<size_t>(1024, buffer_mb * 1024 * 1024 / sizeof(Book_record)))
+    {
+    }
+
+    Book_builder(const Book_builder &) = delete;
+    Book_builder &operator=(const Book_builder &) = delete;
+
+    ~Book_builder()
+    {
+        remove_runs();
+    }
+
+    // Учитывает партию moves с результатом result (1 — победа белых, 0 — ничья, -1 — победа чёрных).
+    // false (партия не учтена), если один из ходов записан ошибочно или невозможен.
+    bool add_game(const vector<string> &moves, const int result)
+    {
+        auto mtx = Board::start_mtx();
+        bool color = false;
+        vector<Book_record> game;
+        for (size_t ply = 0; ply < moves.size() && int(ply) < max_plies; ++ply)
+        {
+            const auto chains = logic.find_full_turns(mtx, color);
+            const int k = Notation::parse_move(moves[ply], chains);
+            if (k < 0)
+            {
+                ++bad_games;
+                return false;
+            }
+            Book_record r;
+            r.key = Zobrist::canonical_key(mtx, color);
+            r.pos = canonical(pack(mtx), color);
+            const int own = color ? -result : result;
+            for (const auto &turn : chains[k])
+                mtx = logic.make_turn(mtx, turn);
+            color = !color;
+            r.next_key = Zobrist::canonical_key(mtx, color);
+            r.games = 1;
+            r.wins = own > 0;
+            r.draws = own == 0;
+            r.losses = own < 0;
+            game.push_back(r);
+        }
+        for (const auto &r : game)
+        {
+            buffer.push_back(r);
+            if (buffer.size() >= capacity)
+                flush();
+        }
+        ++games;
+        return true;
+    }
+
+    // Читает партии из потока in (формат — в описании класса)
+    void add_games(istream &in)
+    {
+        vector<string> moves;
+        string token;
+        while (in >> token)
+        {
+            // Теги и комментарии могут содержать пробелы — пропускаем их до закрывающей скобки
+            if (token[0] == '[' || token[0] == '{')
+            {
+                const char close = token[0] == '[' ? ']' : '}';
+                if (token.find(close) == string::npos)
+                    in.ignore(numeric_limits<streamsize>::max(), close);
+                continue;
+            }
+            int result;
+            if (parse_result(token, result))
+            {
+                if (result != Unknown_result)
+                    add_game(moves, result);
+                moves.clear();
+                continue;
+            }
+            // Номер хода: "12." или "12...", в том числе слитно с ходом ("12.c3-d4")
+            const size_t dot = token.find_last_of('.');
+            if (dot != string::npos && all_of(token.begin(), token.begin() + dot, [](char c) {
+                    return isdigit(static_cast<unsigned char>(c)) || c == '.';
+                }))
+                token = token.substr(dot + 1);
+            if (!token.empty())
+                moves.push_back(token);
+        }
+    }
+
+    // Сливает прогоны и возвращает ходы, сыгранные не менее min_games раз, отсортированные по
+    // ключам; буфер и прогоны после этого пусты
+    vector<Book_record> merge(const uint32_t min_games)
+    {
+        flush();
+        vector<ifstream> runs;
+        for (int n = 0; n < run_count; ++n)
+            runs.emplace_back(run_name(n), ios::binary);
+
+        using Head = pair<Book_record, size_t>;
+        auto greater_head = [](const Head &a, const Head &b) { return b.first < a.first; };
+        priority_queue<Head, vector<Head>, decltype(greater_head)> heads(greater_head);
+        Book_record r;
+        for (size_t n = 0; n < runs.size(); ++n)
+            if (read(runs[n], r))
+                heads.emplace(r, n);
+
+        vector<Book_record> res;
+        Book_record cur;
+        bool have = false;
+        while (!heads.empty())
+        {
+            const Head h = heads.top();
+            heads.pop();
+            if (read(runs[h.second], r))
+                heads.emplace(r, h.second);
+            if (have && cur.same_move(h.first))
+            {
+                cur.add(h.first);
+                continue;
+            }
+            if (have && cur.games >= min_games)
+                res.push_back(cur);
+            cur = h.first;
+            have = true;
+        }
+        if (have && cur.games >= min_games)
+            res.push_back(cur);
+
+        runs.clear();
+        remove_runs();
+        return res;
+    }
+
+    // Ходы книги из статистики records
+    static vector<Book_entry> entries(const vector<Book_record> &records)
+    {
+        vector<Book_entry> res;
+        for (const auto &r : records)
+            res.push_back({r.key, r.next_key, r.weight()});
+        return res;
+    }
+
+    // Учтённые партии и партии, отброшенные из-за ошибочных ходов
+    uint64_t games = 0, bad_games = 0;
+
+  private:
+    static const int Unknown_result = 2;
+
+    static bool parse_result(const string &token, int &result)
+    {
+        if (token == "1-0" || token == "2-0")
+            result = 1;
+        else if (token == "0-1" || token == "0-2")
+            result = -1;
+        else if (token == "1/2-1/2" || token == "1-1")
+            result = 0;
+        else if (token == "*")
+            result = Unknown_result;
+        else
+            return false;
+        return true;
+    }
+
+    // Сортирует буфер, сливает одинаковые ходы и записывает его очередным прогоном
+    void flush()
+    {
+        if (buffer.empty())
+            return;
+        sort(buffer.begin(), buffer.end());
+        size_t n = 0;
+        for (size_t k = 0; k < buffer.size(); ++k)
+        {
+            if (n && buffer[n - 1].same_move(buffer[k]))
+                buffer[n - 1].add(buffer[k]);
+            else
+                buffer[n++] = buffer[k];
+        }
+        ofstream fout(run_name(run_count++), ios::binary | ios::trunc);
+        fout.write(reinterpret_cast<const char *>(buffer.data()), streamsize(n * sizeof(Book_record)));
+        buffer.clear();
+    }
+
+    static bool read(ifstream &in, Book_record &r)
+    {
+        return bool(in.read(reinterpret_cast<char *>(&r), sizeof(r)));
+    }
+
+    string run_name(const int n) const
+    {
+        return temp + ".run" + to_string(n);
+    }
+
+    void remove_runs()
+    {
+        for (int n = 0; n < run_count; ++n)
+            std::remove(run_name(n).c_str());
+        run_count = 0;
+    }
+
+    Move_gen &logic;
+    string temp;
+    int max_plies;
+    size_t capacity;
+    vector<Book_record> buffer;
+    int run_count = 0;
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Evaluators.h"
+#include "Search_memory.h"
+
+using namespace std;
+
+// Оценка позиций, которые поиск не может "выиграть", но исход которых известен:
+// известная победа выше любой материальной оценки, но ниже оценок форсированной победы.
+const SCORE_T KNOWN_WIN_SCORE = 100 * MAN_SCORE;
+
+// Сколько полуходов нужно, чтобы довести известную победу распознавателя до конца: три дамки против
+// одинокой по базам до 4 фигур выигрывают не дольше чем за 28 полуходов, больше дамок — быстрее.
+// Если до ничьей по числу ходов осталось не больше, поиск не опирается на известную победу.
+const int KNOWN_WIN_PLIES = 28;
+
+// Распознаватели эндшпилей с дамками.
+// Соотношение материала (белые шашки, белые дамки, чёрные шашки, чёрные дамки) — индекс в таблице,
+// которая сопоставляет ему распознаватель. Распознаватель по расстановке возвращает точную оценку
+// (ничья) или границу (известная победа), и поиск завершает узел, не перебирая ходы до полной глубины.
+// Правила из теории русских шашек:
+//  - дамка против дамки вне большой дороги (диагональ a1-h8) — ничья;
+//  - две или три дамки против одинокой дамки на большой дороге — ничья, если одинокая дамка ходит сама,
+//    а на большой дороге нет фигур противника (иначе её можно запереть в углу);
+//  - три и более дамки против одинокой дамки вне большой дороги — победа, если сильнейшая сторона держит
+//    большую дорогу своей дамкой, а одинокая дамка ничего не бьёт и, если ходит она, не выходит на дорогу;
+//  - остальное (в том числе две дамки против одинокой вне большой дороги) оставлено перебору.
+// Распознаватели вызываются только в позициях без взятий у ходящей стороны. Tools/Tablebase_gen сверяет
+// их с базами: на всех позициях до 4 фигур ничьи совпадают с ничьими баз, а победы — с выигрышами
+// не дольше KNOWN_WIN_PLIES полуходов.
+class Endgame
+{
+  public:
+    // Результат распознавания с точки зрения белых; bound == NONE — позиция не распознана.
+    struct Result
+    {
+        SCORE_T score = 0;
+        Search_memory::Bound bound = Search_memory::NONE;
+    };
+
+    // Распознаёт позицию mtx, в которой ходит color и у него нет взятий.
+    static Result probe(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        int cnt[5] = {0, 0, 0, 0, 0};
+        bool king_on_main[2] = {false, false};
+        bool on_main[2] = {false, false};
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                const POS_T type = mtx[i][j];
+                ++cnt[type];
+                if (type != 0 && i + j == 7)
+                {
+                    on_main[type % 2 == 0] = true;
+                    if (type >= 3)
+                        king_on_main[type == 4] = true;
+                }
+            }
+        }
+
+        Result res;
+        const auto id = table().id[signature(cnt[1], cnt[3], cnt[2], cnt[4])];
+        switch (id)
+        {
+        case KING_VS_KING:
+            // На большой дороге дамку можно запереть в углу — такие позиции считает поиск
+            if (!king_on_main[0] && !king_on_main[1])
+                res.bound = Search_memory::EXACT;
+            break;
+        case WHITE_VS_LONE_KING:
+        case BLACK_VS_LONE_KING: {
+            const bool lone = id == WHITE_VS_LONE_KING;
+            const bool strong = !lone;
+            const int strong_kings = cnt[3 + strong], strong_men = cnt[1 + strong];
+            if (king_on_main[lone])
+            {
+                // Ничья, если одинокая дамка ходит сама и большая дорога свободна от фигур противника:
+                // тогда её нельзя запереть в углу, а две-три дамки без неё не ловят
+                if (color == lone && !on_main[strong] && strong_men == 0 && strong_kings <= 3)
+                    res.bound = Search_memory::EXACT;
+            }
+            else if (strong_kings >= 3 && king_on_main[strong])
+            {
+                // Известная победа: сильнейшая сторона держит большую дорогу, одинокая дамка вне её,
+                // ничего не бьёт и за свой ход на неё не выходит. Оценка не меньше KNOWN_WIN_SCORE
+                // (плюс лишний материал)
+                const Lone_king lk = scan(mtx, 3 + lone);
+                if (!lk.can_beat && (color == strong || !lk.reach_main))
+                {
+                    const SCORE_T score = KNOWN_WIN_SCORE + (strong_kings + strong_men) * MAN_SCORE;
+                    res.score = strong ? -score : score;
+                    res.bound = strong ? Search_memory::UPPER : Search_memory::LOWER;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        return res;
+    }
+
+  private:
+    // Что может одинокая дамка своим ходом: взять фигуру противника или выйти на большую дорогу.
+    struct Lone_king
+    {
+        bool can_beat = false;
+        bool reach_main = false;
+    };
+
+    // Лучи одинокой дамки type по четырём направлениям: свободные поля и первая встреченная фигура
+    static Lone_king scan(const vector<vector<POS_T>> &mtx, const POS_T type)
+    {
+        POS_T x = 0, y = 0;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j] == type)
+                {
+                    x = i;
+                    y = j;
+                }
+            }
+        }
+        Lone_king res;
+        const bool color = type == 4;
+        for (int dx = -1; dx <= 1; dx += 2)
+        {
+            for (int dy = -1; dy <= 1; dy += 2)
+            {
+                int i = x + dx, j = y + dy;
+                for (; i >= 0 && i < 8 && j >= 0 && j < 8 && mtx[i][j] == 0; i += dx, j += dy)
+                {
+                    if (i + j == 7)
+                        res.reach_main = true;
+                }
+                // За краем доски или своя фигура — брать нечего
+                if (i < 0 || i >= 8 || j < 0 || j >= 8 || (mtx[i][j] % 2 == 0) == color)
+                    continue;
+                const int ni = i + dx, nj = j + dy;
+                if (ni >= 0 && ni < 8 && nj >= 0 && nj < 8 && mtx[ni][nj] == 0)
+                    res.can_beat = true;
+            }
+        }
+        return res;
+    }
+
+    enum Recognizer : uint8_t
+    {
+        NONE,
+        KING_VS_KING,
+        WHITE_VS_LONE_KING, // у белых дамки (и, возможно, шашки), у чёрных одна дамка
+        BLACK_VS_LONE_KING  // наоборот
+    };
+
+    static int signature(const int wm, const int wk, const int bm, const int bk)
+    {
+        return ((wm * 13 + wk) * 13 + bm) * 13 + bk;
+    }
+
+    struct Table
+    {
+        uint8_t id[13 * 13 * 13 * 13] = {};
+
+        Table()
+        {
+            id[signature(0, 1, 0, 1)] = KING_VS_KING;
+            for (int men = 0; men <= 12; ++men)
+            {
+                for (int kings = 2; men + kings <= 12; ++kings)
+                {
+                    // Ничьи бывают только с чистыми дамками, победы — с любым числом шашек в придачу
+                    if (men == 0 || kings >= 3)
+                    {
+                        id[signature(men, kings, 0, 1)] = WHITE_VS_LONE_KING;
+                        id[signature(0, 1, men, kings)] = BLACK_VS_LONE_KING;
+                    }
+                }
+            }
+        }
+    };
+
+    static const Table &table()
+    {
+        static const Table t;
+        return t;
+    }
+};
@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "../Models/Move.h"
+#include "Hash.h"
+
+using namespace std;
+
+const int INF = 1e9;
+
+// Оценки поиска — целые числа в сотых долях шашки (шашка = MAN_SCORE) с точки зрения бота.
+// Победа на глубине d оценивается как WIN_SCORE - d, поражение — как -(WIN_SCORE - d),
+// поэтому бот предпочитает более быстрые победы и более долгие поражения.
+typedef int SCORE_T;
+const SCORE_T MAN_SCORE = 100;
+const SCORE_T WIN_SCORE = 1000000;
+const SCORE_T INF_SCORE = WIN_SCORE + 1;
+
+// Оценки больше WIN_BOUND по модулю означают форсированную победу или поражение
+const SCORE_T WIN_BOUND = WIN_SCORE - 10000;
+
+// Функции оценки позиции для поиска бота.
+// Оценщик — класс с типом State (слагаемые оценки, которые поиск обновляет на каждом ходе) и
+// статическими методами:
+//   init(mtx)                       — State позиции mtx (полный проход по доске, только в корне);
+//   add / remove(st, piece, i, j)   — изменение State при появлении/исчезновении фигуры на клетке;
+//   calc_score(st, first_bot_color) — оценка SCORE_T по State (±WIN_SCORE, если у одной из сторон
+//                                     не осталось фигур; расстояние до победы учитывает поиск);
+//                                     оценка за чёрных — оценка за белых с обратным знаком;
+//   cheap_score(st, first_bot_color) — дешёвая часть оценки (материал);
+//   lazy_margin()                   — насколько полная оценка может отличаться от дешёвой
+//                                     (0 — дешёвой части нет, ленивая оценка не применяется);
+//   calc_batch(pos, n, out, first_bot_color) — оценки n упакованных позиций (см. Logic::evaluate_batch);
+// и константой Cached — стоит ли кэшировать оценки по ключу позиции (см. Search_memory::eval_of):
+// для дорогих оценщиков обращение к кэшу дешевле подсчёта, для материальных — нет.
+// Logic выбирает оценщик один раз (по настройке "BotScoringType") и подставляет его параметром
+// шаблона поиска, поэтому в листьях нет сравнений строк и ветвлений по режиму, а сам подсчёт встраивается.
+// Новый режим оценки — новый класс здесь, значение Scoring_type и одна строка в Logic::search_root.
+
+// Режимы оценки, соответствующие значениям "BotScoringType".
+enum class Scoring_type
+{
+    NumberOnly,        // только количество шашек и дамок
+    NumberAndPotential, // также продвижение шашек к превращению в дамку
+    Patterns,           // NumberAndPotential плюс веса шаблонов на блоках доски (Pattern_eval.h)
+    Neural              // нейросеть с инкрементальным первым слоем (Neural_eval.h)
+};
+
+// Слагаемые материальной оценки: sum — сумма значений таблицы фигура-клетка, count — число фигур.
+// Индекс 0 — белые (фигуры 1 и 3), 1 — чёрные (фигуры 2 и 4).
+// key — ключ Зобриста расстановки фигур (без стороны, которая ходит) для кэша оценок.
+struct Material_state
+{
+    SCORE_T sum[2] = {0, 0};
+    int count[2] = {0, 0};
+    uint64_t key = 0;
+};
+
+// Оценка по материалу через таблицу фигура-клетка.
+// Q_coef — ценность дамки в шашках, Potential — учитывать ли продвижение шашек вперёд.
+// Логика:
+//  1) Шашка стоит MAN_SCORE, дамка — Q_coef * MAN_SCORE.
+//  2) При Potential шашка получает 0.05 шашки за каждый пройденный ряд
+//     (белые идут к 0-му ряду, чёрные — к 7-му).
+//  3) Если у соперника нет фигур — возвращается WIN_SCORE (победа), если у бота — -WIN_SCORE.
+//  4) Итоговая оценка = (фигуры бота) - (фигуры соперника).
+// Оценка в листе — пара сложений: суммы ведутся поиском на каждом ходе через add/remove.
+template <int Q_coef, bool Potential> struct Material_eval
+{
+    typedef Material_state State;
+    static const bool Cached = false;
+
+    // Значение фигуры piece (1..4) на клетке (i, j) в сотых долях шашки
+    static SCORE_T pst(const POS_T piece, const POS_T i, const POS_T j)
+    {
+        return table().value[piece][i][j];
+    }
+
+    static void add(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        st.sum[piece % 2 == 0] += pst(piece, i, j);
+        ++st.count[piece % 2 == 0];
+        st.key ^= Zobrist::piece_key(piece, i, j);
+    }
+
+    static void remove(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        st.sum[piece % 2 == 0] -= pst(piece, i, j);
+        --st.count[piece % 2 == 0];
+        st.key ^= Zobrist::piece_key(piece, i, j);
+    }
+
+    static State init(const vector<vector<POS_T>> &mtx)
+    {
+        State st;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j])
+                    add(st, mtx[i][j], i, j);
+            }
+        }
+        return st;
+    }
+
+    // first_bot_color — true, если бот играет за чёрных.
+    static SCORE_T calc_score(const State &st, const bool first_bot_color)
+    {
+        if (st.count[!first_bot_color] == 0)
+            return WIN_SCORE;
+        if (st.count[first_bot_color] == 0)
+            return -WIN_SCORE;
+        return st.sum[first_bot_color] - st.sum[!first_bot_color];
+    }
+
+    static SCORE_T calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color)
+    {
+        return calc_score(init(mtx), first_bot_color);
+    }
+
+    // Материальная оценка и есть вся оценка — отдельной дешёвой части нет
+    static SCORE_T cheap_score(const State &st, const bool first_bot_color)
+    {
+        return calc_score(st, first_bot_color);
+    }
+
+    static SCORE_T lazy_margin()
+    {
+        return 0;
+    }
+
+    // Пакетная оценка: out[k] = calc_score(позиция pos[k], first_bot_color), k < n.
+    // Позиции идут блоками по Batch, битовые доски блока перекладываются по типам фигур
+    // (структура массивов), и внутренние циклы по позициям блока векторизуются.
+    // Значение фигуры в таблице зависит только от ряда, поэтому сумма позиции — число фигур
+    // в каждом ряду (popcount 4 бит ряда), умноженное на значение ряда.
+    // Реализация выбирается при запуске: собранная под AVX2, если процессор его поддерживает, иначе базовая.
+    static const int Batch = 64;
+
+    static void calc_batch(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color)
+    {
+        table().batch_kernel(pos, n, out, first_bot_color);
+    }
+
+    static const char *batch_kernel_name()
+    {
+        return table().batch_kernel == &calc_batch_generic ? "generic" : "avx2";
+    }
+
+    static CPU_FORCE_INLINE void calc_batch_body(const Packed_position *pos, const size_t n, SCORE_T *out,
+                                                 const bool first_bot_color)
+    {
+        for (size_t start = 0; start < n; start += Batch)
+        {
+            const int m = int(min<size_t>(Batch, n - start));
+            alignas(64) uint32_t planes[4][Batch] = {};
+            for (int k = 0; k < m; ++k)
+                for (int p = 0; p < 4; ++p)
+                    planes[p][k] = pos[start + k].bb[p];
+
+            alignas(64) SCORE_T sum[2][Batch] = {};
+            alignas(64) int32_t count[2][Batch] = {};
+            for (POS_T piece = 1; piece <= 4; ++piece)
+            {
+                const uint32_t *plane = planes[piece - 1];
+                SCORE_T *s = sum[piece % 2 == 0];
+                int32_t *c = count[piece % 2 == 0];
+                for (POS_T i = 0; i < 8; ++i)
+                {
+                    const SCORE_T value = pst(piece, i, POS_T(1 - i % 2));
+                    for (int k = 0; k < Batch; ++k)
+                    {
+                        // Число единиц в 4 битах ряда без popcount (векторизуется на любом SIMD)
+                        uint32_t row = plane[k] >> (4 * i) & 0xF;
+                        row = (row & 0x5) + (row >> 1 & 0x5);
+                        row = (row & 0x3) + (row >> 2 & 0x3);
+                        s[k] += SCORE_T(row) * value;
+                        c[k] += int32_t(row);
+                    }
+                }
+            }
+
+            const bool bot = first_bot_color;
+            for (int k = 0; k < m; ++k)
+            {
+                out[start + k] = count[!bot][k] == 0 ? WIN_SCORE
+                                 : count[bot][k] == 0 ? -WIN_SCORE
+                                                      : sum[bot][k] - sum[!bot][k];
+            }
+        }
+    }
+
+    // Прежняя оценка-отношение: (фигуры бота) / (фигуры соперника) с учётом ценности дамок,
+    // INF — победа, 0 — поражение. Поиск её больше не использует, оставлена для внешних потребителей.
+    static double calc_ratio(const vector<vector<POS_T>> &mtx, const bool first_bot_color)
+    {
+        // Счётчики для шашек и дамок обеих сторон
+        double w = 0, wq = 0, b = 0, bq = 0;
+
+        // Подсчёт фигур
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                w  += (mtx[i][j] == 1);
+                wq += (mtx[i][j] == 3);
+                b  += (mtx[i][j] == 2);
+                bq += (mtx[i][j] == 4);
+
+                // Учитываем продвижение шашек вперёд
+                if (Potential)
+                {
+                    w += 0.05 * (mtx[i][j] == 1) * (7 - i); // Белые — чем ближе к дамке, тем больше вес
+                    b += 0.05 * (mtx[i][j] == 2) * (i);     // Чёрные — аналогично
+                }
+            }
+        }
+
+        // Если бот играет за белых — меняем местами счётчики (w — соперник, b — бот)
+        if (!first_bot_color)
+        {
+            swap(b, w);
+            swap(bq, wq);
+        }
+
+        // Если у соперника нет фигур — победа
+        if (w + wq == 0)
+            return INF;
+
+        // Если у бота нет фигур — поражение
+        if (b + bq == 0)
+            return 0;
+
+        return (b + bq * Q_coef) / (w + wq * Q_coef);
+    }
+
+  private:
+    static void calc_batch_generic(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color)
+    {
+        calc_batch_body(pos, n, out, first_bot_color);
+    }
+
+#if CPU_DISPATCH_X86
+    CPU_TARGET("avx2") static void calc_batch_avx2(const Packed_position *pos, const size_t n, SCORE_T *out,
+                                                   const bool first_bot_color)
+    {
+        calc_batch_body(pos, n, out, first_bot_color);
+    }
+#endif
+
+    struct Table
+    {
+        SCORE_T value[5][8][8] = {};
+        void (*batch_kernel)(const Packed_position *, size_t, SCORE_T *, bool) = &calc_batch_generic;
+
+        Table()
+        {
+#if CPU_DISPATCH_X86
+            if (Cpu_features::get().use_avx2())
+                batch_kernel = &calc_batch_avx2;
+#endif
+            for (int i = 0; i < 8; ++i)
+            {
+                for (int j = 0; j < 8; ++j)
+                {
+                    value[1][i][j] = MAN_SCORE + (Potential ? 5 * (7 - i) : 0);
+                    value[2][i][j] = MAN_SCORE + (Potential ? 5 * i : 0);
+                    value[3][i][j] = value[4][i][j] = Q_coef * MAN_SCORE;
+                }
+            }
+        }
+    };
+
+    static const Table &table()
+    {
+        static const Table t;
+        return t;
+    }
+};
+
+using Number_eval = Material_eval<4, false>;
+using Number_and_potential_eval = Material_eval<5, true>;
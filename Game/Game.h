@@ -41,12 +41,24 @@ class Game
         int turn_num = -1;           // номер текущего хода (увеличивается в начале каждого цикла)
         bool is_quit = false;        // флаг выхода по желанию игрока
         const int Max_turns = config("Game", "MaxNumTurns"); // ограничение по числу ходов
+        bool is_rule_draw = false;   // ничья по правилам: повторение позиции или ходы одними дамками
+        vector<vector<vector<POS_T>>> positions; // позиции в начале каждого хода — история для Logic
 
         // Главный цикл игры: выполняем до тех пор, пока не исчерпаем лимит ходов
         while (++turn_num < Max_turns)
         {
             beat_series = 0; // сбрасываем счётчик последовательных взятий для текущего хода
 
+            // История партии: после отката ходов лишние позиции отбрасываются
+            positions.resize(turn_num);
+            positions.push_back(board.get_board());
+            logic.set_history(positions);
+            if (logic.is_rule_draw())
+            {
+                is_rule_draw = true;
+                break;
+            }
+
             // Генерируем все возможные ходы для текущего игрока (turn_num % 2 — цвет)
             logic.find_turns(turn_num % 2);
 
@@ -54,14 +66,20 @@ class Game
             if (logic.turns.empty())
                 break;
 
-            // Устанавливаем глубину/уровень бота в зависимости от конфига и текущего цвета
-            logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));
+            // Устанавливаем уровень бота (глубина, лимиты узлов и времени) в зависимости от конфига и текущего цвета
+            logic.set_level(config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel")));
 
             // Если текущий цвет управляется человеком — запускаем обработку хода игрока
             if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
             {
+                // Пока человек думает, бот-соперник обдумывает свои ответы
+                if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")))
+                    logic.start_ponder(1 - turn_num % 2,
+                                       config("Bot", string((1 - turn_num % 2) ? "Black" : "White") + string("BotLevel")));
+
                 // Выполняем ход игрока: функция вернёт код ответа (QUIT / REPLAY / BACK / OK)
                 auto resp = player_turn(turn_num % 2);
+                logic.stop_ponder();
 
                 // Обработка специальных ответов:
                 if (resp == Response::QUIT)
@@ -95,8 +113,27 @@ class Game
                 }
             }
             else
-                // Если ходит бот — вызываем функцию выполнения хода ботом
-                bot_turn(turn_num % 2);
+            {
+                // Если ходит бот — вызываем функцию выполнения хода ботом.
+                // Пока бот думает, пользователь может закрыть окно, перезапустить партию или отменить ход.
+                auto resp = bot_turn(turn_num % 2);
+                if (resp == Response::QUIT)
+                {
+                    is_quit = true;
+                    break;
+                }
+                else if (resp == Response::REPLAY)
+                {
+                    is_replay = true;
+                    break;
+                }
+                else if (resp == Response::BACK)
+                {
+                    // Отменяем последний ход соперника — он будет сделан заново
+                    board.rollback();
+                    turn_num -= 2;
+                }
+            }
         }
 
         // Время окончания партии — логируем длительность игры в файл
@@ -116,9 +153,9 @@ class Game
         // Определяем результат партии:
         // res = 2 — неопределённый / предотвращённый вследствие выхода, 1/0 — победитель по цвету/ничья
         int res = 2;
-        if (turn_num == Max_turns)
+        if (turn_num == Max_turns || is_rule_draw)
         {
-            // Достигнут лимит ходов — считаем ничью
+            // Достигнут лимит ходов или ничья по правилам
             res = 0;
         }
         else if (turn_num % 2)
@@ -144,23 +181,36 @@ class Game
     }
 
   private:
-// Функция выполнения хода ботом
-    void bot_turn(const bool color)  // color - цвет шашек бота (0-белые, 1-черные)
+// Функция выполнения хода ботом.
+    // Поиск идёт в отдельном потоке, а главный поток продолжает обрабатывать события окна.
+    // Возвращает OK, если ход сделан, или QUIT / REPLAY / BACK, если поиск был прерван пользователем.
+    Response bot_turn(const bool color)  // color - цвет шашек бота (0-белые, 1-черные)
     {
         // Засекаем время начала хода для замера производительности
         auto start = chrono::steady_clock::now();
 
         // Получаем задержку для бота из конфига (имитация "думания")
         auto delay_ms = config("Bot", "BotDelayMS");
-        
-        // Запускаем поток с задержкой (чтобы бот не делал ходы мгновенно)
-        thread th(SDL_Delay, delay_ms);
-        
-        // Параллельно ищем лучшие ходы для текущего цвета
-        auto turns = logic.find_best_turns(color);
-        
-        // Дожидаемся завершения потока с задержкой
-        th.join();
+        auto min_end = start + chrono::milliseconds(int(delay_ms));
+
+        // Запускаем поиск лучших ходов для текущего цвета в отдельном потоке
+        auto search = logic.find_best_turns_async(color);
+
+        // Пока бот думает (и не истекла минимальная задержка), обрабатываем события окна
+        Response resp = Response::OK;
+        while (search.wait_for(chrono::milliseconds(10)) != future_status::ready ||
+               chrono::steady_clock::now() < min_end)
+        {
+            resp = hand.poll();
+            if (resp != Response::OK)
+            {
+                logic.stop();
+                break;
+            }
+        }
+        auto turns = search.get();
+        if (resp != Response::OK)
+            return resp;
         
         bool is_first = true;  // Флаг первого хода в серии
         
@@ -188,8 +238,25 @@ class Game
         ofstream fout(project_path + "log.txt", ios_base::app);
         fout << "Bot turn time: " 
             << (int)chrono::duration<double, milli>(end - start).count() 
-            << " millisec\n";
+            << " millisec, nodes: " << logic.nodes << ", depth: " << logic.reached_depth;
+        if (logic.eval_probes)
+            fout << ", eval cache hits: " << logic.eval_hits << "/" << logic.eval_probes << " ("
+                 << logic.eval_hits * 100 / logic.eval_probes << "%)";
+        if (logic.lazy_probes)
+            fout << ", lazy eval skips: " << logic.lazy_skips << "/" << logic.lazy_probes << " ("
+                 << logic.lazy_skips * 100 / logic.lazy_probes << "%), drift: " << logic.lazy_drift << "/"
+                 << logic.lazy_samples << " sampled";
+        if (logic.tb_hits)
+            fout << ", tablebase hits: " << logic.tb_hits;
+        if (logic.bitbase_hits)
+            fout << ", bitbase hits: " << logic.bitbase_hits;
+        if (logic.book_move)
+            fout << ", book move";
+        if (logic.forced_move)
+            fout << ", forced move";
+        fout << "\n";
         fout.close();
+        return Response::OK;
     }
 
     Response player_turn(const bool color)
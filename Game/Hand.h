@@ -87,6 +87,43 @@ class Hand
         return {resp, xc, yc};
     }
 
+    // Неблокирующая обработка накопившихся событий окна (пока бот думает в отдельном потоке).
+    // Возвращает QUIT / REPLAY / BACK, если пользователь нажал соответствующую кнопку, иначе OK.
+    // Клики по клеткам доски игнорируются.
+    Response poll() const
+    {
+        SDL_Event windowEvent;
+        Response resp = Response::OK;
+
+        while (resp == Response::OK && SDL_PollEvent(&windowEvent))
+        {
+            switch (windowEvent.type)
+            {
+            case SDL_QUIT:
+                resp = Response::QUIT;
+                break;
+
+            case SDL_MOUSEBUTTONDOWN: {
+                int xc = int(windowEvent.motion.y / (board->H / 10) - 1);
+                int yc = int(windowEvent.motion.x / (board->W / 10) - 1);
+
+                // (-1,-1) — кнопка "назад", (-1,8) — кнопка "переиграть"
+                if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)
+                    resp = Response::BACK;
+                else if (xc == -1 && yc == 8)
+                    resp = Response::REPLAY;
+            }
+            break;
+
+            case SDL_WINDOWEVENT:
+                if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    board->reset_window_size();
+                break;
+            }
+        }
+        return resp;
+    }
+
     // Метод ожидания простого события (без выбора клетки) — например, нажатия кнопки "переиграть" или выхода
     Response wait() const
     {
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../Models/Move.h"
+
+using namespace std;
+
+// Хеширование позиций по Зобристу.
+// Каждой паре (фигура, клетка) и стороне, которая ходит, сопоставлено случайное 64-битное число,
+// ключ позиции — XOR чисел всех фигур на доске. Таблица фиксирована (генератор с постоянным зерном),
+// поэтому ключи одинаковы от запуска к запуску и могут храниться в файлах.
+class Zobrist
+{
+  public:
+    // Ключ позиции mtx, в которой ходит color (false — белые, true — чёрные).
+    static uint64_t key(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        const auto &t = table();
+        uint64_t res = color ? t.side : 0;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j])
+                    res ^= t.piece[mtx[i][j]][i][j];
+            }
+        }
+        return res;
+    }
+
+    // Канонический ключ: ключ канонической формы позиции (см. canonical в Bitboard.h) — позиции mtx
+    // с ходом белых или, если ходят чёрные, её отражения с обменом цветов. Одинаков у позиции и её
+    // отражения, поэтому хранилище по этому ключу не различает их и находит одну по другой.
+    static uint64_t canonical_key(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        if (!color)
+            return key(mtx, false);
+        const auto &t = table();
+        uint64_t res = 0;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                // Белые фигуры (нечётные) становятся чёрными того же вида и наоборот
+                const POS_T p = mtx[i][j];
+                if (p)
+                    res ^= t.piece[p % 2 ? p + 1 : p - 1][7 - i][7 - j];
+            }
+        }
+        return res;
+    }
+
+    // Число фигуры piece на клетке (i, j): ключ можно вести инкрементально, XOR-я его при ходах.
+    static uint64_t piece_key(const POS_T piece, const POS_T i, const POS_T j)
+    {
+        return table().piece[piece][i][j];
+    }
+
+    // Число стороны color, которая ходит: ключ позиции — ключ расстановки XOR это число.
+    static uint64_t side_key(const bool color)
+    {
+        return color ? table().side : 0;
+    }
+
+  private:
+    struct Table
+    {
+        uint64_t piece[5][8][8] = {}; // piece[0] — пустая клетка, всегда 0
+        uint64_t side = 0;
+
+        Table()
+        {
+            mt19937_64 gen(20240501);
+            for (int p = 1; p < 5; ++p)
+                for (int i = 0; i < 8; ++i)
+                    for (int j = 0; j < 8; ++j)
+                        piece[p][i][j] = gen();
+            side = gen();
+        }
+    };
+
+    static const Table &table()
+    {
+        static const Table t;
+        return t;
+    }
+};
@@ -2,58 +2,787 @@
 #include <random>
 #include <vector>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include "../Models/Move.h"
+#include "Bitbase.h"
 #include "Board.h"
+#include "Book.h"
 #include "Config.h"
-
-const int INF = 1e9;
+#include "Endgame.h"
+#include "Evaluators.h"
+#include "Hash.h"
+#include "Neural_eval.h"
+#include "Pattern_eval.h"
+#include "Search_memory.h"
+#include "Solver.h"
+#include "Tablebase.h"
 
 class Logic
 {
   public:
     Logic(Board *board, Config *config) : board(board), config(config)
     {
+        no_random = (*config)("Bot", "NoRandom");
         rand_eng = std::default_random_engine (
-            !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0);
-        scoring_mode = (*config)("Bot", "BotScoringType");
-        optimization = (*config)("Bot", "Optimization");
+            !no_random ? unsigned(time(0)) : 0);
+        // Режимы оценки и отсечений разбираются один раз: дальше они — параметры шаблонов поиска
+        const string scoring_name = (*config)("Bot", "BotScoringType");
+        scoring = scoring_name == "NumberAndPotential" ? Scoring_type::NumberAndPotential
+                  : scoring_name == "Patterns"         ? Scoring_type::Patterns
+                  : scoring_name == "Neural"           ? Scoring_type::Neural
+                                                       : Scoring_type::NumberOnly;
+        const string pattern_weights = (*config)("Bot", "PatternWeights");
+        if (scoring == Scoring_type::Patterns && !pattern_weights.empty())
+            Pattern_eval::load(pattern_weights); // без файла остаются ручные веса
+        // Без файла весов сеть не работает — играем оценкой "NumberAndPotential"
+        if (scoring == Scoring_type::Neural && !Neural_eval::loaded() &&
+            !Neural_eval::load((*config)("Bot", "NeuralWeights").get<string>()))
+            scoring = Scoring_type::NumberAndPotential;
+        pruning = (*config)("Bot", "Optimization") != "O0";
+        threads = max(1u, unsigned((*config)("Bot", "Threads")));
+        deterministic_threads = (*config)("Bot", "DeterministicThreads");
+        ponder_enabled = (*config)("Bot", "Ponder");
+        const size_t hash_mb = (*config)("Bot", "HashMB");
+        const size_t eval_cache_kb = (*config)("Bot", "EvalCacheKB");
+        lazy_margin = (*config)("Bot", "LazyEvalMargin");
+        max_extensions = (*config)("Bot", "OnlyMoveExtensions");
+        king_moves_draw = (*config)("Game", "KingMovesDraw");
+        max_turns = (*config)("Game", "MaxNumTurns");
+        memory[0] = make_shared<Search_memory>(hash_mb, eval_cache_kb);
+        memory[1] = make_shared<Search_memory>(hash_mb, eval_cache_kb);
+        // Базы открываются отображением файлов в память — без чтения с диска
+        const string tablebase_dir = (*config)("Bot", "TablebaseDir");
+        if (!tablebase_dir.empty())
+        {
+            tablebase = make_shared<Tablebase>(project_path + tablebase_dir, size_t((*config)("Bot", "TablebaseCacheMB")));
+            if (tablebase->pieces() == 0)
+                tablebase.reset();
+        }
+        // Битовые базы читаются из файла (около 2 МБ) или строятся при первом поиске
+        const string bitbase_file = (*config)("Bot", "BitbaseFile");
+        if (!bitbase_file.empty())
+            bitbase = make_shared<Bitbase>(project_path + bitbase_file);
+        // Дебютная книга тоже отображается в память: позиции ищутся в файле по мере надобности
+        const string book_file = (*config)("Bot", "BookFile");
+        if (!book_file.empty())
+        {
+            book = make_shared<Book>();
+            if (!book->open(project_path + book_file))
+                book.reset();
+        }
+    }
+
+    // Устанавливает ограничения поиска для уровня бота level из настройки "Levels":
+    // максимальную глубину, число узлов и время (0 — без ограничения).
+    // Если уровень в "Levels" не описан, глубина равна level, а узлы и время не ограничены.
+    void set_level(const int level)
+    {
+        this->level = level;
+        Max_depth = level;
+        max_nodes = 0;
+        max_time_ms = 0;
+
+        auto levels = (*config)("Bot", "Levels");
+        if (!levels.is_array() || level < 0 || level >= int(levels.size()))
+            return;
+        const auto &preset = levels[level];
+        Max_depth = preset.value("Depth", level);
+        max_nodes = preset.value("Nodes", size_t(0));
+        max_time_ms = preset.value("TimeMS", 0);
     }
 
     vector<move_pos> find_best_turns(const bool color)
 {
-    next_best_state.clear();
-    next_move.clear();
+    // Единственный возможный ход (чаще всего обязательное взятие) играется без поиска
+    forced_move = book_move = false;
+    if (turns.size() == 1)
+    {
+        const auto root_turns = turns;
+        const bool root_beats = have_beats;
+        const auto chains = find_full_turns(board->get_board(), color);
+        turns = root_turns;
+        have_beats = root_beats;
+        if (chains.size() == 1)
+        {
+            nodes = 0;
+            reset_eval_stats();
+            reached_depth = -1;
+            score = 0;
+            forced_move = true;
+            return chains[0];
+        }
+    }
+
+    // Ход из дебютной книги — без поиска
+    if (book)
+    {
+        auto res = book_turn(board->get_board(), color);
+        if (!res.empty())
+        {
+            nodes = 0;
+            reset_eval_stats();
+            book_move = true;
+            return res;
+        }
+    }
+
+    // Если позиция уже была обдумана во время хода соперника — отвечаем сразу
+    auto pondered = ponder_table->find(Zobrist::key(board->get_board(), color));
+    if (pondered != ponder_table->end() && pondered->second.level == level)
+    {
+        nodes = 0;
+        reset_eval_stats();
+        return pondered->second.turns;
+    }
+
+    // Битовых баз нет на диске — строим их в фоне копией Logic без ссылок на базы
+    if (bitbase && !bitbase->is_ready())
+    {
+        Logic gen(*this);
+        gen.bitbase.reset();
+        gen.tablebase.reset();
+        bitbase->prepare(gen);
+    }
+
+    return search_root(board->get_board(), color);
+}
+
+    // Заменяет эндшпильные базы из настроек (nullptr — поиск без баз).
+    // Генератор баз отключает их, чтобы не держать отображёнными файлы, которые он перезаписывает.
+    void set_tablebase(shared_ptr<Tablebase> tb)
+    {
+        tablebase = move(tb);
+    }
 
-    // Запускаем поиск (начальное состояние — текущая доска).
-    find_first_best_turn(board->get_board(), color, -1, -1, 0);
+    // История партии: позиции в начале каждого полухода, от начальной до текущей включительно
+    // (ходят по очереди белые и чёрные). Поиск считает ничьей повторение позиции из истории или пути
+    // поиска, учитывает ходы дамками из истории в правиле "KingMovesDraw", а по числу позиций знает,
+    // сколько полуходов осталось до ничьей по "MaxNumTurns". Без истории корень поиска — начало партии.
+    void set_history(const vector<vector<vector<POS_T>>> &positions)
+    {
+        game_keys.clear();
+        game_from = 0;
+        for (size_t k = 0; k < positions.size(); ++k)
+        {
+            game_keys.push_back(Zobrist::key(positions[k], false));
+            const uint64_t men = men_signature(positions[k]);
+            if (k > 0 && men != game_men)
+                game_from = k;
+            game_men = men;
+        }
+    }
+
+    // Ничья по правилам в последней позиции истории: позиция повторилась в третий раз
+    // или "KingMovesDraw" полуходов подряд обе стороны ходили только дамками без взятий
+    bool is_rule_draw() const
+    {
+        if (game_keys.empty())
+            return false;
+        const size_t n = game_keys.size();
+        if (king_moves_draw && n - 1 - game_from >= size_t(king_moves_draw))
+            return true;
+        // Та же позиция с тем же ходящим — через чётное число полуходов, не раньше необратимого хода
+        int seen = 0;
+        for (size_t i = n - 1;; i -= 2)
+        {
+            seen += game_keys[i] == game_keys[n - 1];
+            if (i < game_from + 2)
+                break;
+        }
+        return seen >= 3;
+    }
+
+    // Заменяет дебютную книгу из настроек (nullptr — без книги).
+    // Построитель книг отключает её, чтобы не держать отображённым файл, который он перезаписывает.
+    void set_book(shared_ptr<Book> b)
+    {
+        book = move(b);
+    }
+
+    // Ход дебютной книги в позиции mtx, где ходит color; пустой, если позиции нет в книге.
+    // Из ходов книги, возможных в позиции, при "NoRandom" выбирается ход с наибольшим весом,
+    // иначе — случайный с вероятностью, пропорциональной весу.
+    vector<move_pos> book_turn(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        const auto entries = book->moves(Zobrist::canonical_key(mtx, color));
+        if (entries.empty())
+            return {};
+
+        // Генерация ходов меняет turns — список ходов корня для поиска
+        const auto saved_turns = turns;
+        const bool saved_beats = have_beats;
+        vector<vector<move_pos>> chains;
+        vector<uint64_t> weights;
+        for (const auto &chain : find_full_turns(mtx, color))
+        {
+            auto mtx2 = mtx;
+            for (const auto &turn : chain)
+                mtx2 = make_turn(mtx2, turn);
+            const uint64_t next_key = Zobrist::canonical_key(mtx2, !color);
+            for (const auto &e : entries)
+            {
+                if (e.next_key == next_key && e.weight > 0)
+                {
+                    chains.push_back(chain);
+                    weights.push_back(e.weight);
+                    break;
+                }
+            }
+        }
+        turns = saved_turns;
+        have_beats = saved_beats;
+        if (chains.empty())
+            return {};
+
+        size_t pick = 0;
+        if (no_random)
+            pick = size_t(max_element(weights.begin(), weights.end()) - weights.begin());
+        else
+        {
+            uint64_t total = 0;
+            for (const auto w : weights)
+                total += w;
+            uint64_t r = uniform_int_distribution<uint64_t>(0, total - 1)(rand_eng);
+            while (r >= weights[pick])
+                r -= weights[pick++];
+        }
+        return chains[pick];
+    }
+
+    // Пакетная оценка n упакованных позиций (см. Packed_position) оценщиком из настройки "BotScoringType":
+    // out[k] — оценка pos[k] с точки зрения чёрных, если first_bot_color, иначе белых.
+    // Без поиска и учёта того, кто ходит; для анализа партий, настройки весов и обучения.
+    void evaluate_batch(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color) const
+    {
+        switch (scoring)
+        {
+        case Scoring_type::NumberAndPotential:
+            return Number_and_potential_eval::calc_batch(pos, n, out, first_bot_color);
+        case Scoring_type::Patterns:
+            return Pattern_eval::calc_batch(pos, n, out, first_bot_color);
+        case Scoring_type::Neural:
+            return Neural_eval::calc_batch(pos, n, out, first_bot_color);
+        default:
+            return Number_eval::calc_batch(pos, n, out, first_bot_color);
+        }
+    }
+
+    // Доказывает результат позиции mtx, где ходит color, решателем по числам доказательства (Solver.h):
+    // plies — сколько полуходов осталось до ничьей по "MaxNumTurns", mb — память таблицы решателя,
+    // max_nodes — предел узлов (0 — без предела). Используются загруженные битовые и файловые базы
+    // и правило "KingMovesDraw" (счёт с позиции mtx); троекратное повторение не учитывается.
+    Solver_report solve(const vector<vector<POS_T>> &mtx, const bool color, const int plies, const size_t mb,
+                        const uint64_t max_nodes = 0) const
+    {
+        Logic worker(*this);
+        Pn_solver<Logic> solver(worker, mb, max_nodes, bitbase.get(), tablebase.get(), king_moves_draw);
+        return solver.solve(mtx, color, plies);
+    }
+
+    // Описание возможностей процессора и выбранных для них реализаций горячих ядер (флаг --cpu-features).
+    // Генерация ходов работает с доской mtx и одна для всех процессоров.
+    static string cpu_report()
+    {
+        string res = "CPU features: " + Cpu_features::get().to_string() + "\n";
+        res += "move generation: generic\n";
+        res += string("pattern evaluation: ") + Pattern_eval::kernel_name() + "\n";
+        res += string("neural evaluation: ") + Neural_eval::kernel_name() + "\n";
+        res += string("batch evaluation: ") + Number_eval::batch_kernel_name() + "\n";
+        return res;
+    }
+
+    // Обдумывание во время хода человека.
+    // color — цвет бота, который будет ходить после человека, level — его уровень (см. set_level).
+    // В фоновом потоке копия Logic перебирает все ответы человека и для каждой получившейся позиции
+    // ищет ход бота, сохраняя результаты в ponder_table. Если человек сделает один из обдуманных ходов,
+    // find_best_turns() вернёт готовый ответ без поиска.
+    void start_ponder(const bool color, const int level)
+    {
+        stop_ponder();
+        ponder_table->clear();
+        if (!ponder_enabled)
+            return;
+
+        Logic worker(*this);
+        worker.set_level(level);
+        worker.stop_flag = make_shared<atomic<bool>>(false);
+        worker.rand_eng.seed(rand_eng());
+        ponder_stop = worker.stop_flag;
+        const auto mtx = board->get_board();
+        ponder_done = async(launch::async, [worker, mtx, color]() mutable { worker.ponder(mtx, color); }).share();
+    }
+
+    // Останавливает обдумывание и дожидается фонового потока. Уже найденные ответы остаются в ponder_table.
+    void stop_ponder()
+    {
+        if (!ponder_done.valid())
+            return;
+        ponder_stop->store(true);
+        ponder_done.wait();
+        ponder_done = shared_future<void>();
+    }
+
+    // Все полные ходы стороны color из позиции mtx (цепочки взятий раскрываются до конца).
+    vector<vector<move_pos>> find_full_turns(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        vector<vector<move_pos>> res;
+        find_turns(color, mtx);
+        vector<move_pos> chain;
+        for (auto turn : vector<move_pos>(turns))
+            expand_turn(mtx, turn, chain, res);
+        return res;
+    }
+
+    // Лучший ход в позиции mtx, где ходит color, поиском с ограничениями текущего уровня — без доски,
+    // книги и обдумывания (для утилит). Оценка хода — в score; пустой результат, если ходов нет.
+    vector<move_pos> search_position(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        find_turns(color, mtx);
+        if (turns.empty())
+            return {};
+        return search_root(mtx, color);
+    }
+
+
+    // Запускает find_best_turns() в отдельном потоке, чтобы главный цикл мог обрабатывать события окна.
+    // Пока результат не получен, объект Logic нельзя использовать из других потоков (кроме stop()).
+    future<vector<move_pos>> find_best_turns_async(const bool color)
+    {
+        stop_flag->store(false);
+        return async(launch::async, [this, color] { return find_best_turns(color); });
+    }
+
+    // Прерывает текущий поиск (может вызываться из другого потока).
+    // find_best_turns() завершается в течение нескольких миллисекунд, результат при этом не годен.
+    void stop()
+    {
+        stop_flag->store(true);
+    }
+
+private:
+
+// Поиск лучшего хода из позиции mtx. Корневые ходы должны быть уже найдены в turns.
+// Поиск итеративный: глубины 0, 1, ..., Max_depth, пока не исчерпаны лимиты узлов и времени уровня.
+// Результатом служит последняя полностью завершённая итерация, поэтому поиск всегда укладывается
+// в лимит (с точностью до проверки часов раз в 256 узлов) и всегда возвращает допустимый ход.
+vector<move_pos> search_root(const vector<vector<POS_T>> &mtx, const bool color)
+{
+    // Выбор специализации поиска — один раз на ход
+    switch (scoring)
+    {
+    case Scoring_type::NumberAndPotential:
+        return pruning ? iterative_search<Number_and_potential_eval, true>(mtx, color)
+                       : iterative_search<Number_and_potential_eval, false>(mtx, color);
+    case Scoring_type::Patterns:
+        return pruning ? iterative_search<Pattern_eval, true>(mtx, color)
+                       : iterative_search<Pattern_eval, false>(mtx, color);
+    case Scoring_type::Neural:
+        return pruning ? iterative_search<Neural_eval, true>(mtx, color)
+                       : iterative_search<Neural_eval, false>(mtx, color);
+    default:
+        return pruning ? iterative_search<Number_eval, true>(mtx, color)
+                       : iterative_search<Number_eval, false>(mtx, color);
+    }
+}
+
+template <class Evaluator, bool Pruning>
+vector<move_pos> iterative_search(const vector<vector<POS_T>> &mtx, const bool color)
+{
+    nodes = 0;
+    reset_eval_stats();
+    score = 0;
+    out_of_limits = false;
+    deadline = max_time_ms ? chrono::steady_clock::now() + chrono::milliseconds(max_time_ms)
+                           : chrono::steady_clock::time_point::max();
+
+    // Память поиска своего цвета: таблица транспозиций и история остались от прошлых ходов
+    mem = memory[color].get();
+    mem->age();
+    start_path(mtx);
+    const uint64_t root_key = Zobrist::key(mtx, color);
+    const auto root_turns = turns;
+    const bool root_beats = have_beats;
+    const int target_depth = Max_depth;
 
-    // Восстанавливаем найденную цепочку ходов по индексам.
-    int cur_state = 0;
     vector<move_pos> res;
-    do
+    vector<Logic> workers;
+    for (reached_depth = -1; reached_depth < target_depth; ++reached_depth)
     {
-        res.push_back(next_move[cur_state]);
-        cur_state = next_best_state[cur_state];
-    } while (cur_state != -1 && next_move[cur_state].x != -1);
+        Max_depth = reached_depth + 1;
+        turns = root_turns;
+        have_beats = root_beats;
+        order_turns(turns, root_key);
+        next_best_state.clear();
+        next_move.clear();
+
+        vector<move_pos> cur;
+        SCORE_T cur_score;
+        if (threads > 1 && turns.size() > 1)
+        {
+            cur = find_best_turns_parallel<Evaluator, Pruning>(mtx, color, cur_score, workers);
+        }
+        else
+        {
+            // Запускаем поиск (начальное состояние — mtx).
+            cur_score = find_first_best_turn<Evaluator, Pruning>(mtx, Evaluator::init(mtx), color, -1, -1, 0);
+
+            // Восстанавливаем найденную цепочку ходов по индексам.
+            cur = restore_turns(0);
+        }
+        if (aborted() || cur.empty())
+            break;
+
+        res = cur;
+        score = cur_score;
+        mem->store(root_key, res[0], Max_depth + 1);
+    }
+    Max_depth = target_depth;
+
+    // Лимит закончился раньше первой итерации — берём первый по порядку ход, раскрыв цепочку взятий
+    if (res.empty())
+    {
+        turns = root_turns;
+        order_turns(turns, root_key);
+        const move_pos first = turns[0];
+        for (const auto &chain : find_full_turns(mtx, color))
+        {
+            if (chain[0] == first)
+                return chain;
+        }
+    }
     return res;
 }
 
+// Обнуляет счётчики кэша и ленивой оценки перед поиском.
+void reset_eval_stats()
+{
+    eval_probes = eval_hits = 0;
+    lazy_probes = lazy_skips = lazy_samples = lazy_drift = 0;
+    tb_hits = bitbase_hits = 0;
+}
 
-private:
+// Поиск прерван: извне (stop()) или исчерпаны лимиты узлов/времени уровня.
+bool aborted() const
+{
+    return out_of_limits || stop_flag->load(memory_order_relaxed);
+}
+
+// Подпись необратимой части позиции: расстановка шашек и число дамок. Ход, меняющий её (ход шашкой,
+// взятие), необратим — позиции до него повториться уже не могут.
+static uint64_t men_signature(const vector<vector<POS_T>> &mtx)
+{
+    uint64_t res = 0, kings = 0;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+        for (POS_T j = 0; j < 8; ++j)
+        {
+            if (mtx[i][j] == 1 || mtx[i][j] == 2)
+                res ^= Zobrist::piece_key(mtx[i][j], i, j);
+            else if (mtx[i][j])
+                ++kings;
+        }
+    }
+    return res + kings;
+}
+
+// Путь поиска из корня mtx: история партии (set_history) и сам корень, если он не последняя её позиция
+// (обдумывание ответа на ход соперника, поиск утилит)
+void start_path(const vector<vector<POS_T>> &mtx)
+{
+    rep_path = game_keys;
+    rep_from = game_from;
+    const uint64_t root = Zobrist::key(mtx, false);
+    if (rep_path.empty() || rep_path.back() != root)
+    {
+        if (rep_path.empty() || men_signature(mtx) != game_men)
+            rep_from = rep_path.size();
+        rep_path.push_back(root);
+    }
+    rep_filter.fill(0);
+    for (const uint64_t key : rep_path)
+        ++rep_filter[key % rep_filter.size()];
+    // Корень — полуход номер rep_path.size() - 1 партии
+    root_plies_left = max_turns - int(rep_path.size() - 1);
+}
+
+void push_path(const uint64_t key)
+{
+    rep_path.push_back(key);
+    ++rep_filter[key % rep_filter.size()];
+}
+
+void pop_path()
+{
+    --rep_filter[rep_path.back() % rep_filter.size()];
+    rep_path.pop_back();
+}
+
+// Начало обратимого хвоста пути для позиции после хода turn из последней позиции пути mtx:
+// после взятия или хода шашкой хвост начинается заново
+size_t rep_from_after(const vector<vector<POS_T>> &mtx, const move_pos &turn) const
+{
+    return turn.xb != -1 || mtx[turn.x][turn.y] <= 2 ? rep_path.size() : rep_from;
+}
+
+// Ничья в полной позиции с расстановкой key, следующей за последней позицией пути: повторение позиции
+// с тем же ходящим после последнего необратимого хода или исчерпанное правило "KingMovesDraw".
+// Пустая ячейка rep_filter отвечает без просмотра пути.
+bool path_draw(const uint64_t key) const
+{
+    const size_t n = rep_path.size();
+    if (king_moves_draw && n - rep_from >= size_t(king_moves_draw))
+        return true;
+    if (!rep_filter[key % rep_filter.size()])
+        return false;
+    for (size_t i = n; i >= rep_from + 2;)
+    {
+        i -= 2;
+        if (rep_path[i] == key)
+            return true;
+    }
+    return false;
+}
+
+// Упорядочивание ходов позиции key: сначала лучший ход из таблицы транспозиций,
+// затем ходы, чаще дававшие отсечения (таблица истории). Сортировка устойчивая,
+// поэтому при равной истории сохраняется случайный порядок из find_turns.
+void order_turns(vector<move_pos> &turns_now, const uint64_t key) const
+{
+    stable_sort(turns_now.begin(), turns_now.end(), [this](const move_pos &a, const move_pos &b) {
+        return mem->history_of(a) > mem->history_of(b);
+    });
+    if (auto e = mem->probe(key))
+    {
+        auto it = find(turns_now.begin(), turns_now.end(), move_pos(e->x, e->y, e->x2, e->y2));
+        if (it != turns_now.end())
+            rotate(turns_now.begin(), it, it + 1);
+    }
+}
+
+// Тело фонового обдумывания (см. start_ponder). Выполняется на копии Logic.
+void ponder(const vector<vector<POS_T>> &mtx, const bool color)
+{
+    // Первым обдумываем ответ, который прошлый поиск бота считал лучшим для соперника
+    auto replies = find_full_turns(mtx, 1 - color);
+    if (auto e = memory[color]->probe(Zobrist::key(mtx, 1 - color)))
+    {
+        const move_pos predicted(e->x, e->y, e->x2, e->y2);
+        stable_partition(replies.begin(), replies.end(),
+                         [&](const vector<move_pos> &chain) { return chain[0] == predicted; });
+    }
+
+    for (const auto &chain : replies)
+    {
+        auto mtx2 = mtx;
+        for (const auto &turn : chain)
+            mtx2 = make_turn(mtx2, turn);
+
+        find_turns(color, mtx2);
+        if (turns.empty())
+            continue;
+        auto res = search_root(mtx2, color);
+        if (stop_flag->load())
+            return;
+        (*ponder_table)[Zobrist::key(mtx2, color)] = {level, res};
+    }
+}
+
+// Раскрывает ход turn (и продолжения взятий после него) в полные цепочки, добавляя их в res.
+void expand_turn(const vector<vector<POS_T>> &mtx, const move_pos &turn, vector<move_pos> &chain,
+                 vector<vector<move_pos>> &res)
+{
+    chain.push_back(turn);
+    auto mtx2 = make_turn(mtx, turn);
+    if (turn.xb != -1)
+        find_turns(turn.x2, turn.y2, mtx2);
+    if (turn.xb != -1 && have_beats)
+    {
+        for (auto next : vector<move_pos>(turns))
+            expand_turn(mtx2, next, chain, res);
+    }
+    else
+    {
+        res.push_back(chain);
+    }
+    chain.pop_back();
+}
+
+// Единственный ли полный ход в позиции mtx с первыми шагами turns_now: шаг один, и цепочка взятий
+// после него нигде не ветвится (как при раскрытии в expand_turn). Меняет turns и have_beats.
+bool single_full_turn(const vector<vector<POS_T>> &mtx, const vector<move_pos> &turns_now, const bool beats)
+{
+    if (turns_now.size() != 1)
+        return false;
+    if (!beats)
+        return true;
+    move_pos turn = turns_now[0];
+    auto mtx2 = mtx;
+    while (true)
+    {
+        mtx2 = make_turn(mtx2, turn);
+        find_turns(turn.x2, turn.y2, mtx2);
+        if (!have_beats)
+            return true;
+        if (turns.size() != 1)
+            return false;
+        turn = turns[0];
+    }
+}
+
+// Восстанавливает цепочку ходов, начиная с состояния state, по next_move/next_best_state.
+vector<move_pos> restore_turns(int state) const
+{
+    vector<move_pos> res;
+    for (; state != -1 && next_move[state].x != -1; state = next_best_state[state])
+        res.push_back(next_move[state]);
+    return res;
+}
+
+// Параллельный поиск на уровне корня. Корневые ходы (уже найденные в turns) статически
+// распределяются между потоками: ход i считает поток i % threads, у каждого потока своя копия Logic
+// (workers — общие для всех итераций одного поиска) со своим генератором, засеянным из rand_eng. Результаты сливаются в порядке корневых ходов,
+// поэтому при DeterministicThreads ход, оценка и число узлов зависят только от числа потоков.
+// Без DeterministicThreads потоки обмениваются лучшей оценкой для отсечений: быстрее, но
+// результат зависит от планировщика.
+// Ход, оценка которого не превысила alpha, получает лишь верхнюю границу (fail-soft), которая может
+// совпасть с alpha; alpha могла прийти от хода другого потока с большим индексом, и при равенстве
+// граница обошла бы сам этот ход. Поэтому в слиянии участвуют только точные оценки.
+template <class Evaluator, bool Pruning>
+vector<move_pos> find_best_turns_parallel(const vector<vector<POS_T>> &mtx, const bool color, SCORE_T &root_score,
+                                          vector<Logic> &workers)
+{
+    const auto root_turns = turns;
+    const bool root_beats = have_beats;
+    const size_t n = min<size_t>(threads, root_turns.size());
+
+    vector<SCORE_T> scores(root_turns.size(), -INF_SCORE);
+    vector<char> exact(root_turns.size(), 0);
+    vector<vector<move_pos>> chains(root_turns.size());
+    // Потоки и их копии памяти поиска создаются на первой итерации и живут до конца поиска:
+    // таблица копируется один раз на ход, а не на каждую итерацию
+    if (workers.empty())
+    {
+        workers.assign(n, *this);
+        for (auto &worker : workers)
+        {
+            worker.memory[color] = make_shared<Search_memory>(mem->fork());
+            worker.mem = worker.memory[color].get();
+        }
+    }
+    for (auto &worker : workers)
+    {
+        worker.rand_eng.seed(rand_eng());
+        worker.Max_depth = Max_depth;
+        worker.rep_from = rep_from;
+        // Лимит узлов делится поровну, так что в детерминированном режиме он тоже воспроизводим
+        worker.nodes = 0;
+        worker.reset_eval_stats();
+        if (max_nodes)
+            worker.max_nodes = max<size_t>(1, (max_nodes - min(max_nodes, nodes)) / n);
+    }
+    atomic<SCORE_T> shared_best(-INF_SCORE);
+    const auto root_st = Evaluator::init(mtx);
+
+    auto work = [&](const size_t w) {
+        Logic &worker = workers[w];
+        SCORE_T best_score = -INF_SCORE;
+        const size_t root_from = worker.rep_from;
+        for (size_t i = w; i < root_turns.size() && !worker.aborted(); i += n)
+        {
+            const auto &turn = root_turns[i];
+            worker.rep_from = root_from;
+            worker.rep_from = worker.rep_from_after(mtx, turn);
+            SCORE_T alpha = best_score;
+            if (!deterministic_threads)
+                alpha = max(alpha, shared_best.load());
+
+            chains[i] = {turn};
+            auto st = root_st;
+            auto mtx2 = make_turn<Evaluator>(mtx, turn, st);
+            if (root_beats)
+            {
+                // Фиктивное состояние 0, чтобы продолжение цепочки взятий начиналось с состояния 1
+                worker.next_best_state.assign(1, -1);
+                worker.next_move.assign(1, move_pos(-1, -1, -1, -1));
+                scores[i] = worker.find_first_best_turn<Evaluator, Pruning>(mtx2, st, color, turn.x2, turn.y2, 1, alpha);
+                auto tail = worker.restore_turns(1);
+                chains[i].insert(chains[i].end(), tail.begin(), tail.end());
+            }
+            else
+            {
+                scores[i] = worker.find_best_turns_rec<Evaluator, Pruning>(mtx2, st, 1 - color, 0, alpha);
+            }
+
+            // Лучшая оценка потока и общая — только из точных оценок, так что каждая alpha достигается ходом
+            exact[i] = alpha == -INF_SCORE || scores[i] > alpha;
+            if (!exact[i])
+                continue;
+            best_score = max(best_score, scores[i]);
+            SCORE_T cur = shared_best.load();
+            while (cur < best_score && !shared_best.compare_exchange_weak(cur, best_score))
+            {
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t w = 1; w < n; ++w)
+        pool.emplace_back(work, w);
+    work(0);
+    for (auto &th : pool)
+        th.join();
+
+    // Слияние строго в порядке корневых ходов: при равных оценках побеждает первый ход.
+    // Ходы с границей вместо оценки не лучше некоторого точного хода и отбрасываются.
+    size_t best = root_turns.size();
+    for (size_t i = 0; i < root_turns.size(); ++i)
+    {
+        if (exact[i] && (best == root_turns.size() || scores[i] > scores[best]))
+            best = i;
+    }
+    // Точных оценок нет только у прерванной итерации, результат которой всё равно отбрасывается
+    if (best == root_turns.size())
+        best = 0;
+    // Изменения памяти потоков вливаются по порядку после каждой итерации
+    for (auto &worker : workers)
+    {
+        nodes += worker.nodes;
+        eval_probes += worker.eval_probes;
+        eval_hits += worker.eval_hits;
+        lazy_probes += worker.lazy_probes;
+        lazy_skips += worker.lazy_skips;
+        lazy_samples += worker.lazy_samples;
+        lazy_drift += worker.lazy_drift;
+        tb_hits += worker.tb_hits;
+        bitbase_hits += worker.bitbase_hits;
+        out_of_limits |= worker.out_of_limits;
+        mem->merge(*worker.mem);
+    }
+    root_score = scores[best];
+    return chains[best];
+}
 
 // Ищет лучший ход (и возможную цепочку взятий) начиная с конкретной клетки/цепочки.
 // mtx - текущая доска, color - текущий игрок, (x,y) - если != -1, то ищем ходы для этой фигуры,
-// state - индекс состояния в next_move/next_best_state, alpha - параметр для отсечения.
-double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-    double alpha = -1)
+// st - слагаемые оценки позиции mtx (см. Evaluators.h),
+// state - индекс состояния в next_move/next_best_state, alpha - лучшая оценка, уже гарантированная боту.
+template <class Evaluator, bool Pruning>
+SCORE_T find_first_best_turn(vector<vector<POS_T>> mtx, const typename Evaluator::State st, const bool color, const POS_T x, const POS_T y, size_t state,
+    SCORE_T alpha = -INF_SCORE)
 {
     // Регистрируем новое состояние
     next_best_state.push_back(-1);
     next_move.emplace_back(-1, -1, -1, -1);
 
-    double best_score = -1;
+    SCORE_T best_score = -INF_SCORE;
 
     if (state != 0)
         find_turns(x, y, mtx);
@@ -65,24 +794,34 @@ double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const P
     // переключаем сторону и используем общий рекурсивный поиск.
     if (!have_beats_now && state != 0)
     {
-        return find_best_turns_rec(mtx, 1 - color, 0, alpha);
+        return find_best_turns_rec<Evaluator, Pruning>(mtx, st, 1 - color, 0, alpha);
     }
 
     for (auto turn : turns_now)
     {
+        if (aborted())
+            break;
+
         size_t next_state = next_move.size();
-        double score;
+        SCORE_T score;
+        const size_t saved_from = rep_from;
+        if (state == 0)
+            rep_from = rep_from_after(mtx, turn);
+        auto st2 = st;
+        auto mtx2 = make_turn<Evaluator>(mtx, turn, st2);
 
         if (have_beats_now)
         {
             // продолжаем цепочку (цвет не переключается)
-            score = find_first_best_turn(make_turn(mtx, turn), color, turn.x2, turn.y2, next_state, best_score);
+            score = find_first_best_turn<Evaluator, Pruning>(move(mtx2), st2, color, turn.x2, turn.y2, next_state,
+                                                             max(alpha, best_score));
         }
         else
         {
             // обычный ход — переключаем цвет
-            score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, 0, best_score);
+            score = find_best_turns_rec<Evaluator, Pruning>(move(mtx2), st2, 1 - color, 0, max(alpha, best_score));
         }
+        rep_from = saved_from;
 
         if (score > best_score)
         {
@@ -96,15 +835,70 @@ double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const P
 }
 
 // Рекурсивный minimax-поиск с (опциональным) alpha-beta отсечением.
-// mtx - позиция, color - текущий игрок, depth - глубина,
-// alpha/beta - параметры отсечения, x/y - если заданы, ищем ходы для конкретной фигуры (цепочка взятий).
-double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1,
-    double beta = INF + 1, const POS_T x = -1, const POS_T y = -1)
+// mtx - позиция, st - её слагаемые оценки, color - текущий игрок, depth - глубина,
+// alpha/beta - окно отсечения (оценки с точки зрения бота), x/y - если заданы, ищем ходы
+// для конкретной фигуры (цепочка взятий). На нечётной глубине ходит бот (максимизирует оценку),
+// на чётной — соперник (минимизирует). Возвращаемая оценка вне окна — соответствующая граница.
+template <class Evaluator, bool Pruning>
+SCORE_T find_best_turns_rec(vector<vector<POS_T>> mtx, const typename Evaluator::State st, const bool color,
+    const size_t depth,
+    SCORE_T alpha = -INF_SCORE, SCORE_T beta = INF_SCORE, const POS_T x = -1, const POS_T y = -1)
 {
-    // Базовый случай
-    if (depth == Max_depth)
+    ++nodes;
+    if ((max_nodes && nodes >= max_nodes) || ((nodes & 255) == 0 && chrono::steady_clock::now() >= deadline))
+        out_of_limits = true;
+
+    // Поиск прерван — результат незавершённой итерации всё равно будет отброшен
+    if (aborted())
+        return 0;
+
+    // Партия закончилась ничьей по "MaxNumTurns" раньше, чем дошла до этой позиции (она на depth + 1
+    // полуходов дальше корня), либо позиция повторилась или исчерпано правило ходов дамками —
+    // ничья, что бы ни говорили базы и оценка
+    if (x == -1 && (int(depth) + 1 >= root_plies_left || path_draw(st.key)))
+        return 0;
+
+    // Эндшпили с малым числом фигур. Сначала битовая база в памяти: ничья — точная оценка;
+    // выигрыш и проигрыш уточняются по файловым базам (расстояние до конца), а без них —
+    // граница известной победы, как у распознавателей Endgame.h, если самый долгий выигрыш
+    // класса успевает до ничьей по числу ходов
+    if (x == -1)
     {
-        return calc_score(mtx, (depth % 2 == color));
+        const int pieces = st.count[0] + st.count[1];
+        uint8_t wdl = Bitbase::DRAW;
+        int longest = 0;
+        const bool in_bitbase =
+            bitbase && pieces <= Bitbase::Pieces && bitbase->probe(mtx, color, wdl, longest);
+        if (in_bitbase)
+            ++bitbase_hits;
+        if (in_bitbase && wdl == Bitbase::DRAW)
+            return 0;
+
+        SCORE_T score;
+        if (tablebase && pieces <= tablebase->pieces() && probe_tablebase(mtx, color, depth, score))
+            return score;
+
+        if (in_bitbase && Pruning && longest < plies_to_draw(mtx, depth))
+        {
+            // На нечётной глубине ходит бот
+            const bool bot_wins = (wdl == Bitbase::WIN) == (depth % 2 == 1);
+            const SCORE_T known = KNOWN_WIN_SCORE + pieces * MAN_SCORE;
+            if (bot_wins && known >= beta)
+                return known;
+            if (!bot_wins && -known <= alpha)
+                return -known;
+        }
+    }
+
+    // Базовый случай: победа/поражение по оценке переводим в расстояние от корня
+    if (int(depth) >= Max_depth + extensions)
+    {
+        const SCORE_T score = evaluate<Evaluator, Pruning>(st, (depth % 2 == color), alpha, beta);
+        if (score >= WIN_SCORE)
+            return WIN_SCORE - SCORE_T(depth);
+        if (score <= -WIN_SCORE)
+            return -WIN_SCORE + SCORE_T(depth);
+        return score;
     }
 
     if (x != -1)
@@ -122,28 +916,87 @@ double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const si
     // Если в цепочке удары закончились — переключаем игрока и глубину
     if (!have_beats_now && x != -1)
     {
-        return find_best_turns_rec(mtx, 1 - color, depth + 1, alpha, beta);
+        return find_best_turns_rec<Evaluator, Pruning>(mtx, st, 1 - color, depth + 1, alpha, beta);
     }
 
-    // Терминальное состояние: ходов нет
+    // Терминальное состояние: ходов нет — ходящая сторона проиграла
     if (turns.empty())
-        return (depth % 2 ? 0 : INF);
+        return (depth % 2 ? -WIN_SCORE + SCORE_T(depth) : WIN_SCORE - SCORE_T(depth));
+
+    // Известные эндшпили (у одной из сторон одна фигура, взятий нет): ничья или граница победы
+    if (x == -1 && !have_beats_now && min(st.count[0], st.count[1]) == 1)
+    {
+        const auto known = Endgame::probe(mtx, color);
+        // Точная оценка — ничья; граница известной победы — если победа успевает до ничьей по числу ходов
+        if (known.bound == Search_memory::EXACT ||
+            (known.bound != Search_memory::NONE && KNOWN_WIN_PLIES < plies_to_draw(mtx, depth)))
+        {
+            // Переводим с точки зрения белых на точку зрения бота (граница меняет направление)
+            const bool bot_is_black = (depth % 2 == color);
+            const SCORE_T score = bot_is_black ? -known.score : known.score;
+            const bool lower = (known.bound == Search_memory::LOWER) != bot_is_black;
+            if (known.bound == Search_memory::EXACT || (Pruning && lower && score >= beta) ||
+                (Pruning && !lower && score <= alpha))
+                return score;
+        }
+    }
 
-    double min_score = INF + 1;
-    double max_score = -1;
+    const int depth_left = Max_depth + extensions - int(depth);
+    const SCORE_T alpha_start = alpha, beta_start = beta;
 
+    // В полных позициях (не в середине цепочки взятий) используем память поиска:
+    // оценку из таблицы транспозиций, если она достаточно глубокая, и порядок ходов.
+    // Ключ позиции — ключ расстановки st.key, который ведёт make_turn, и ходящая сторона
+    uint64_t key = 0;
+    if (x == -1)
+    {
+        key = st.key ^ Zobrist::side_key(color);
+        if (Pruning)
+        {
+            auto e = mem->probe(key);
+            if (e && e->bound != Search_memory::NONE && e->depth >= depth_left)
+            {
+                const SCORE_T score = Search_memory::score_of(*e, int(depth));
+                if (e->bound == Search_memory::EXACT || (e->bound == Search_memory::LOWER && score >= beta) ||
+                    (e->bound == Search_memory::UPPER && score <= alpha))
+                    return score;
+            }
+        }
+        order_turns(turns_now, key);
+    }
+    move_pos best_turn = turns_now[0];
+
+    SCORE_T min_score = INF_SCORE;
+    SCORE_T max_score = -INF_SCORE;
+
+    if (x == -1)
+        push_path(st.key);
+    // Единственный полный ход не расходует глубину: вынужденные ответы (обычно взятия) не сокращают
+    // просмотр вариантов, где есть выбор; не больше max_extensions раз на одном варианте
+    const bool extend =
+        x == -1 && extensions < max_extensions && single_full_turn(mtx, turns_now, have_beats_now);
+    if (extend)
+        ++extensions;
     for (auto turn : turns_now)
     {
-        double score = 0.0;
+        SCORE_T score = 0;
+        const size_t saved_from = rep_from;
+        if (x == -1)
+            rep_from = rep_from_after(mtx, turn);
+        auto st2 = st;
+        auto mtx2 = make_turn<Evaluator>(mtx, turn, st2);
         if (!have_beats_now && x == -1)
         {
-            score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, depth + 1, alpha, beta);
+            score = find_best_turns_rec<Evaluator, Pruning>(move(mtx2), st2, 1 - color, depth + 1, alpha, beta);
         }
         else
         {
-            score = find_best_turns_rec(make_turn(mtx, turn), color, depth, alpha, beta, turn.x2, turn.y2);
+            score = find_best_turns_rec<Evaluator, Pruning>(move(mtx2), st2, color, depth, alpha, beta, turn.x2, turn.y2);
         }
+        rep_from = saved_from;
 
+        if (depth % 2 ? score > max_score : score < min_score)
+            best_turn = turn;
         min_score = std::min(min_score, score);
         max_score = std::max(max_score, score);
 
@@ -152,86 +1005,165 @@ double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const si
         else
             beta = std::min(beta, min_score);
 
-        if (optimization != "O0" && alpha >= beta)
-            return (depth % 2 ? max_score + 1 : min_score - 1);
+        if (Pruning && alpha >= beta)
+        {
+            if (x == -1 && !aborted())
+                mem->history_of(turn) += depth_left * depth_left;
+            break;
+        }
     }
 
-    return (depth % 2 ? max_score : min_score);
-}
+    if (x == -1)
+        pop_path();
+    if (extend)
+        --extensions;
 
-    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    const SCORE_T res = (depth % 2 ? max_score : min_score);
+    if (x == -1 && !aborted())
     {
-        if (turn.xb != -1)
-            mtx[turn.xb][turn.yb] = 0;
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
-            mtx[turn.x][turn.y] += 2;
-        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
-        mtx[turn.x][turn.y] = 0;
-        return mtx;
+        const auto bound = res <= alpha_start  ? Search_memory::UPPER
+                           : res >= beta_start ? Search_memory::LOWER
+                                               : Search_memory::EXACT;
+        mem->store(key, best_turn, depth_left, res, bound, int(depth));
     }
+    return res;
+}
 
-    // Вычисляет "оценку" позиции mtx для алгоритма принятия решений бота.
-    // first_bot_color — цвет, за который играет бот (true/false).
-    // Логика:
-    //  1) Подсчёт количества белых/чёрных шашек и дамок.
-    //  2) При режиме "NumberAndPotential" учитывается потенциальное продвижение вперёд
-    //     (добавляются небольшие бонусы за близость к превращению в дамку).
-    //  3) Если у одной из сторон нет фигур — возвращается +∞ (поражение) или 0 (победа).
-    //  4) Для дамок применяется повышающий коэффициент q_coef (по умолчанию 4 или 5).
-    //  5) Итоговая оценка = (фигуры соперника) / (фигуры бота) с учётом коэффициентов.
-    double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
+    // Сколько полуходов от полной позиции mtx на глубине depth осталось до ничьей по "MaxNumTurns",
+    // а если на доске только дамки — и по "KingMovesDraw" (позиция следует за последней позицией пути):
+    // выигрыш за столько полуходов или дольше уже не довести до конца
+    int plies_to_draw(const vector<vector<POS_T>> &mtx, const size_t depth) const
     {
-        // Счётчики для шашек и дамок обеих сторон
-        double w = 0, wq = 0, b = 0, bq = 0;
+        int res = root_plies_left - int(depth) - 1;
+        if (king_moves_draw && only_kings(mtx))
+            res = min(res, king_moves_draw - int(rep_path.size() - rep_from));
+        return res;
+    }
 
-        // Подсчёт фигур
-        for (POS_T i = 0; i < 8; ++i)
+    static bool only_kings(const vector<vector<POS_T>> &mtx)
+    {
+        for (const auto &row : mtx)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (const POS_T p : row)
             {
-                w  += (mtx[i][j] == 1);
-                wq += (mtx[i][j] == 3);
-                b  += (mtx[i][j] == 2);
-                bq += (mtx[i][j] == 4);
-
-                // Если включен режим "NumberAndPotential" — учитываем продвижение шашек вперёд
-                if (scoring_mode == "NumberAndPotential")
-                {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i); // Белые — чем ближе к дамке, тем больше вес
-                    b += 0.05 * (mtx[i][j] == 2) * (i);     // Чёрные — аналогично
-                }
+                if (p == 1 || p == 2)
+                    return false;
             }
         }
+        return true;
+    }
 
-        // Если бот играет за чёрных — меняем местами счётчики
-        if (!first_bot_color)
+    // Оценка позиции mtx (ходит color, глубина depth) по эндшпильным базам с точки зрения бота.
+    // Выигрыш или проигрыш за d полуходов оценивается как мат на глубине depth + d.
+    bool probe_tablebase(const vector<vector<POS_T>> &mtx, const bool color, const size_t depth, SCORE_T &score)
+    {
+        uint8_t v;
+        if (!tablebase->probe(mtx, color, v))
+            return false;
+        ++tb_hits;
+        if (v == Tb::DRAW)
         {
-            swap(b, w);
-            swap(bq, wq);
+            score = 0;
+            return true;
         }
+        // Выигрыш, который не довести до конца раньше ничьей по "MaxNumTurns" или "KingMovesDraw", — ничья
+        if (Tb::distance(v) >= plies_to_draw(mtx, depth))
+        {
+            score = 0;
+            return true;
+        }
+        const SCORE_T mate = WIN_SCORE - SCORE_T(depth) - Tb::distance(v);
+        // На нечётной глубине ходит бот
+        score = (Tb::is_win(v) == (depth % 2 == 1)) ? mate : -mate;
+        return true;
+    }
 
-        // Если у бота нет фигур — поражение
-        if (w + wq == 0)
-            return INF;
+    // Ленивая оценка листа с окном alpha/beta. Если дешёвая часть оценки (материал) дальше от окна,
+    // чем полная оценка может от неё отличаться (margin), дорогая часть не считается: возвращается
+    // граница cheap -/+ margin, которая отсекает так же, как полная оценка. Каждый 16-й пропуск
+    // проверяется полной оценкой: lazy_drift считает случаи, когда она оказалась бы внутри окна.
+    template <class Evaluator, bool Pruning>
+    SCORE_T evaluate(const typename Evaluator::State &st, const bool first_bot_color, const SCORE_T alpha,
+                     const SCORE_T beta)
+    {
+        if (Pruning && Evaluator::lazy_margin() > 0)
+        {
+            const SCORE_T margin = lazy_margin ? lazy_margin : Evaluator::lazy_margin();
+            const SCORE_T cheap = Evaluator::cheap_score(st, first_bot_color);
+            ++lazy_probes;
+            if (cheap >= WIN_SCORE || cheap <= -WIN_SCORE)
+                return cheap;
 
-        // Если у соперника нет фигур — победа
-        if (b + bq == 0)
-            return 0;
+            SCORE_T bound = INF_SCORE;
+            if (cheap - margin >= beta)
+                bound = cheap - margin;
+            else if (cheap + margin <= alpha)
+                bound = cheap + margin;
+            if (bound != INF_SCORE)
+            {
+                ++lazy_skips;
+                if (lazy_skips % 16 == 0)
+                {
+                    ++lazy_samples;
+                    const SCORE_T full = Evaluator::calc_score(st, first_bot_color);
+                    if (bound >= beta ? full < beta : full > alpha)
+                        ++lazy_drift;
+                }
+                return bound;
+            }
+        }
+        return cached_score<Evaluator>(st, first_bot_color);
+    }
 
-        // Коэффициент ценности дамки
-        int q_coef = 4;
-        if (scoring_mode == "NumberAndPotential")
+    // Оценка листа через кэш оценок (только для оценщиков с Cached, см. Evaluators.h).
+    // В кэше хранится оценка за белых, оценка за чёрных отличается знаком.
+    template <class Evaluator>
+    SCORE_T cached_score(const typename Evaluator::State &st, const bool first_bot_color)
+    {
+        if (!Evaluator::Cached || mem->eval.empty())
+            return Evaluator::calc_score(st, first_bot_color);
+
+        ++eval_probes;
+        auto &e = mem->eval_of(st.key);
+        if (e.key == st.key)
+            ++eval_hits;
+        else
         {
-            q_coef = 5;
+            e.key = st.key;
+            e.score = Evaluator::calc_score(st, false);
         }
-
-        // Чем меньше результат, тем лучше для бота (мы считаем "опасность" позиции)
-        return (b + bq * q_coef) / (w + wq * q_coef);
+        return first_bot_color ? -e.score : e.score;
     }
 
+    // Ход turn на доске mtx с обновлением слагаемых оценки st: вместо пересчёта всей доски
+    // вычитаются вклады фигуры на старой клетке и сбитой фигуры, добавляется вклад на новой клетке.
+    // Откат хода не нужен: поиск передаёт позицию и st по значению.
+    template <class Evaluator>
+    vector<vector<POS_T>> make_turn(const vector<vector<POS_T>> &mtx, const move_pos &turn,
+                                    typename Evaluator::State &st) const
+    {
+        const POS_T piece = mtx[turn.x][turn.y];
+        const bool promote = (piece == 1 && turn.x2 == 0) || (piece == 2 && turn.x2 == 7);
+        if (turn.xb != -1)
+            Evaluator::remove(st, mtx[turn.xb][turn.yb], turn.xb, turn.yb);
+        Evaluator::remove(st, piece, turn.x, turn.y);
+        Evaluator::add(st, piece + 2 * promote, turn.x2, turn.y2);
+        return make_turn(mtx, turn);
+    }
 
-    
 public:
+    // Ход turn (один шаг цепочки) на доске mtx: взятие, превращение в дамку и перенос фигуры.
+    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    {
+        if (turn.xb != -1)
+            mtx[turn.xb][turn.yb] = 0;
+        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
+            mtx[turn.x][turn.y] += 2;
+        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
+        mtx[turn.x][turn.y] = 0;
+        return mtx;
+    }
+
     // Вызов find_turns по цвету игрока.
     // Использует текущее состояние доски из объекта board.
     // Находит все возможные ходы для фигур заданного цвета.
@@ -397,19 +1329,55 @@ private:
     // Максимальная глубина поиска в рекурсивных алгоритмах (используется ботом для выбора хода).
     int Max_depth;
 
+    // Число узлов, посещённых последним вызовом find_best_turns().
+    size_t nodes = 0;
+
+    // Обращения к кэшу оценок и попадания в него за последний вызов find_best_turns().
+    size_t eval_probes = 0, eval_hits = 0;
+
+    // Ленивая оценка за последний вызов find_best_turns(): листья с дешёвой частью оценки, из них
+    // пропуски дорогой части, проверенные полной оценкой пропуски и ошибочные среди проверенных.
+    size_t lazy_probes = 0, lazy_skips = 0, lazy_samples = 0, lazy_drift = 0;
+
+    // Позиции, оценённые по эндшпильным базам и найденные в битовых базах за последний вызов find_best_turns().
+    size_t tb_hits = 0, bitbase_hits = 0;
+
+    // Последний вызов find_best_turns() взял ход из дебютной книги.
+    bool book_move = false;
+
+    // Последний вызов find_best_turns() сыграл единственный возможный ход без поиска.
+    bool forced_move = false;
+
+    // Глубина последней завершённой итерации последнего поиска (-1 — ни одна не завершилась).
+    int reached_depth = -1;
+
+    // Оценка хода, найденного последним поиском (по последней завершённой итерации), с точки зрения
+    // ходящего; 0, если ни одна итерация не завершилась.
+    SCORE_T score = 0;
+
   private:
    // Генератор случайных чисел для перемешивания ходов (если включён рандом).
     default_random_engine rand_eng;
 
-    // Режим подсчёта оценки позиции:
-    // "Number" — учитывается только количество фигур,
-    // "NumberAndPotential" — также учитывается продвижение к превращению в дамку.
-    string scoring_mode;
+    // Режим подсчёта оценки позиции (настройка "BotScoringType"), см. Evaluators.h.
+    Scoring_type scoring = Scoring_type::NumberOnly;
+
+    // Запас ленивой оценки из настройки "LazyEvalMargin" (0 — гарантированный запас оценщика).
+    SCORE_T lazy_margin = 0;
+
+    // Альфа-бета отсечения: выключены при "Optimization": "O0".
+    bool pruning = true;
+
+    // Продления единственного хода на одном варианте: предел из настройки "OnlyMoveExtensions"
+    // и число продлений на пути от корня до текущего узла.
+    int max_extensions = 0;
+    int extensions = 0;
+
+    // Число потоков поиска (1 — однопоточный поиск).
+    unsigned threads = 1;
 
-    // Режим оптимизации поиска:
-    // "O0" — без оптимизации,
-    // другие значения — включают alpha-beta pruning и прочие оптимизации.
-    string optimization;
+    // Детерминированный параллельный режим: потоки не обмениваются оценками во время поиска.
+    bool deterministic_threads = true;
 
     // next_move[state] хранит ход, который был выбран из позиции с индексом state.
     // Используется для восстановления цепочки ходов в find_best_turns().
@@ -419,6 +1387,68 @@ private:
     // -1, если это последний ход в цепочке.
     vector<int> next_best_state;
 
+    // Флаг прерывания поиска. Общий для копий Logic, поэтому останавливает и потоки параллельного поиска.
+    shared_ptr<atomic<bool>> stop_flag = make_shared<atomic<bool>>(false);
+
+    // Память поиска каждого цвета (таблица транспозиций, история), переживает ходы и откаты.
+    // mem — память цвета, для которого идёт текущий поиск.
+    shared_ptr<Search_memory> memory[2];
+    Search_memory *mem = nullptr;
+
+    // Эндшпильные базы (настройка "TablebaseDir"), общие для копий Logic; nullptr — баз нет.
+    shared_ptr<Tablebase> tablebase;
+
+    // Битовые базы до Bitbase::Pieces фигур (настройка "BitbaseFile"), общие для копий Logic.
+    shared_ptr<Bitbase> bitbase;
+
+    // Дебютная книга (настройка "BookFile"), общая для копий Logic; nullptr — книги нет.
+    shared_ptr<Book> book;
+
+    // Настройка "NoRandom": детерминированный выбор, в том числе хода книги.
+    bool no_random = false;
+
+    // Правило "KingMovesDraw": столько полуходов подряд только дамками без взятий — ничья (0 — правило выключено).
+    int king_moves_draw = 0;
+
+    // История партии (set_history): ключи расстановок (без ходящего), начало обратимого хвоста —
+    // позиция после последнего хода шашкой или взятия — и подпись шашек последней позиции (men_signature).
+    vector<uint64_t> game_keys;
+    size_t game_from = 0;
+    uint64_t game_men = 0;
+
+    // Настройка "MaxNumTurns" и сколько полуходов от корня поиска осталось до ничьей по ней.
+    int max_turns = 0;
+    int root_plies_left = 0;
+
+    // Путь поиска для обнаружения повторений: история партии и полные позиции от корня до текущей,
+    // начало обратимого хвоста и число ключей пути в ячейках по остатку ключа (фильтр для path_draw).
+    vector<uint64_t> rep_path;
+    size_t rep_from = 0;
+    array<uint16_t, 4096> rep_filter{};
+
+    // Ограничения поиска текущего уровня (см. set_level): 0 — без ограничения.
+    int level = 0;
+    size_t max_nodes = 0;
+    int max_time_ms = 0;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    bool out_of_limits = false;
+
+    // Результат обдумывания одной позиции: уровень бота и найденная цепочка ходов.
+    struct ponder_result
+    {
+        int level;
+        vector<move_pos> turns;
+    };
+
+    // Обдумывание во время хода человека (см. start_ponder).
+    // ponder_table: ключ позиции после ответа человека -> ответ бота. Фоновый поток пишет в таблицу,
+    // главный поток читает её только после stop_ponder(), поэтому блокировка не нужна.
+    bool ponder_enabled = false;
+    shared_ptr<unordered_map<uint64_t, ponder_result>> ponder_table =
+        make_shared<unordered_map<uint64_t, ponder_result>>();
+    shared_ptr<atomic<bool>> ponder_stop;
+    shared_future<void> ponder_done;
+
     // Указатель на объект Board — текущая доска.
     Board *board;
 
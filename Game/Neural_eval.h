@@ -0,0 +1,314 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "Evaluators.h"
+
+using namespace std;
+
+// Оценка небольшой нейросетью с инкрементальным первым слоем ("BotScoringType": "Neural").
+//
+// Вход — 128 разреженных признаков (тип фигуры 1..4) x (тёмная клетка 0..31), в позиции активны
+// не больше 24. Первый слой (int16) хранится в State как аккумулятор: при появлении фигуры к нему
+// прибавляется столбец весов признака, при исчезновении — вычитается, поэтому ход стоит 2–3
+// сложения векторов, а не пересчёт слоя. В листе аккумулятор проходит через два маленьких плотных
+// слоя с весами int8. Циклы по слоям написаны по массивам фиксированной длины без ветвлений —
+// компилятор векторизует их под SSE/AVX на x86-64 и NEON на ARM, GPU не нужен.
+// Сеть оценивает позицию с точки зрения белых в сотых долях шашки.
+class Neural_eval
+{
+  public:
+    static const int Features = 4 * 32; // (фигура, клетка)
+    static const int Hidden = 64;       // размер аккумулятора
+    static const int L1 = 16;           // второй слой
+    static const int Act_max = 127;     // clipped ReLU: [0, 127], помещается в int8
+    static const int L1_shift = 6;      // масштаб выхода второго слоя
+    static const int Out_shift = 4;     // масштаб итоговой оценки
+    static const bool Cached = true;
+
+    struct State : Material_state
+    {
+        int16_t acc[Hidden];
+    };
+
+    static int feature(const POS_T piece, const POS_T i, const POS_T j)
+    {
+        return (piece - 1) * 32 + square_of(i, j);
+    }
+
+    static void add(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        Number_eval::add(st, piece, i, j);
+        const int16_t *w = net().ft_weight.data() + feature(piece, i, j) * Hidden;
+        for (int h = 0; h < Hidden; ++h)
+            st.acc[h] += w[h];
+    }
+
+    static void remove(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        Number_eval::remove(st, piece, i, j);
+        const int16_t *w = net().ft_weight.data() + feature(piece, i, j) * Hidden;
+        for (int h = 0; h < Hidden; ++h)
+            st.acc[h] -= w[h];
+    }
+
+    static State init(const vector<vector<POS_T>> &mtx)
+    {
+        State st;
+        memcpy(st.acc, net().ft_bias.data(), sizeof(st.acc));
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j])
+                    add(st, mtx[i][j], i, j);
+            }
+        }
+        return st;
+    }
+
+    // Прямой проход плотных слоёв по аккумулятору, оценка с точки зрения белых.
+    // Реализации forward и calc_batch выбираются при запуске: собранные под AVX2, если процессор
+    // его поддерживает, иначе базовые (на ARM базовая сборка уже векторизуется под NEON).
+    static SCORE_T forward(const int16_t *acc)
+    {
+        return kernels().forward(acc);
+    }
+
+    static const char *kernel_name()
+    {
+        return kernels().forward == &forward_generic ? "generic" : "avx2";
+    }
+
+    static CPU_FORCE_INLINE SCORE_T forward_body(const int16_t *acc)
+    {
+        const Network &n = net();
+
+        alignas(64) int8_t a0[Hidden];
+        for (int h = 0; h < Hidden; ++h)
+            a0[h] = int8_t(min(max(int(acc[h]), 0), Act_max));
+
+        alignas(64) int8_t a1[L1];
+        for (int o = 0; o < L1; ++o)
+        {
+            const int8_t *w = n.l1_weight.data() + o * Hidden;
+            int32_t sum = 0;
+            for (int h = 0; h < Hidden; ++h)
+                sum += int32_t(a0[h]) * w[h];
+            a1[o] = int8_t(min(max((sum + n.l1_bias[o]) >> L1_shift, 0), Act_max));
+        }
+
+        int32_t out = n.l2_bias;
+        for (int o = 0; o < L1; ++o)
+            out += int32_t(a1[o]) * n.l2_weight[o];
+        return SCORE_T(out >> Out_shift);
+    }
+
+    // first_bot_color — true, если бот играет за чёрных.
+    static SCORE_T calc_score(const State &st, const bool first_bot_color)
+    {
+        if (st.count[!first_bot_color] == 0)
+            return WIN_SCORE;
+        if (st.count[first_bot_color] == 0)
+            return -WIN_SCORE;
+        // Сеть не должна выдавать оценки из диапазона побед
+        const SCORE_T score = min(max(forward(st.acc), -WIN_BOUND + 1), WIN_BOUND - 1);
+        return first_bot_color ? -score : score;
+    }
+
+    static SCORE_T calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color)
+    {
+        return calc_score(init(mtx), first_bot_color);
+    }
+
+    // Пакетная оценка блоками по Batch позиций. Аккумуляторы строятся разреженными прибавлениями
+    // столбцов весов, как в init, затем активации перекладываются в структуру массивов [нейрон][позиция],
+    // и плотные слои считаются циклами по позициям блока, которые векторизуются.
+    static const int Batch = 32;
+
+    static void calc_batch(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color)
+    {
+        kernels().batch(pos, n, out, first_bot_color);
+    }
+
+    static CPU_FORCE_INLINE void calc_batch_body(const Packed_position *pos, const size_t n, SCORE_T *out,
+                                                 const bool first_bot_color)
+    {
+        const Network &nw = net();
+        for (size_t start = 0; start < n; start += Batch)
+        {
+            const int m = int(min<size_t>(Batch, n - start));
+
+            alignas(64) int8_t a0[Hidden][Batch] = {};
+            for (int k = 0; k < m; ++k)
+            {
+                int16_t acc[Hidden];
+                memcpy(acc, nw.ft_bias.data(), sizeof(acc));
+                for (int p = 0; p < 4; ++p)
+                {
+                    for (uint32_t b = pos[start + k].bb[p]; b; b &= b - 1)
+                    {
+                        const int16_t *w = nw.ft_weight.data() + (p * 32 + popcount32((b & (0 - b)) - 1)) * Hidden;
+                        for (int h = 0; h < Hidden; ++h)
+                            acc[h] += w[h];
+                    }
+                }
+                for (int h = 0; h < Hidden; ++h)
+                    a0[h][k] = int8_t(min(max(int(acc[h]), 0), Act_max));
+            }
+
+            alignas(64) int32_t res[Batch];
+            for (int k = 0; k < Batch; ++k)
+                res[k] = nw.l2_bias;
+            for (int o = 0; o < L1; ++o)
+            {
+                alignas(64) int32_t sum[Batch] = {};
+                for (int h = 0; h < Hidden; ++h)
+                {
+                    const int32_t w = nw.l1_weight[o * Hidden + h];
+                    for (int k = 0; k < Batch; ++k)
+                        sum[k] += int32_t(a0[h][k]) * w;
+                }
+                for (int k = 0; k < Batch; ++k)
+                    res[k] += min(max((sum[k] + nw.l1_bias[o]) >> L1_shift, 0), Act_max) * int32_t(nw.l2_weight[o]);
+            }
+
+            for (int k = 0; k < m; ++k)
+            {
+                const auto &bb = pos[start + k].bb;
+                const int count[2] = {popcount32(bb[0] | bb[2]), popcount32(bb[1] | bb[3])};
+                if (count[!first_bot_color] == 0)
+                    out[start + k] = WIN_SCORE;
+                else if (count[first_bot_color] == 0)
+                    out[start + k] = -WIN_SCORE;
+                else
+                {
+                    const SCORE_T score = min(max(SCORE_T(res[k] >> Out_shift), -WIN_BOUND + 1), WIN_BOUND - 1);
+                    out[start + k] = first_bot_color ? -score : score;
+                }
+            }
+        }
+    }
+
+    // Сеть оценивает позицию целиком, материальная оценка не ограничивает её выход —
+    // отделимой дешёвой части нет, ленивая оценка не применяется.
+    static SCORE_T cheap_score(const State &st, const bool first_bot_color)
+    {
+        return calc_score(st, first_bot_color);
+    }
+
+    static SCORE_T lazy_margin()
+    {
+        return 0;
+    }
+
+    // Загружает веса сети. Формат файла (little-endian):
+    //   "CKNN", uint32 версия (1), uint32 Features, Hidden, L1 (должны совпасть с константами выше), затем
+    //   int16 ft_weight[Features][Hidden], int16 ft_bias[Hidden],
+    //   int8 l1_weight[L1][Hidden], int32 l1_bias[L1], int8 l2_weight[L1], int32 l2_bias.
+    // Возвращает false, если файла нет или формат не совпадает; тогда оценщик использовать нельзя.
+    static bool load(const string &path)
+    {
+        ifstream fin(path, ios::binary);
+        char magic[4];
+        uint32_t header[4] = {};
+        if (!fin.read(magic, 4) || memcmp(magic, "CKNN", 4) != 0)
+            return false;
+        fin.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (!fin || header[0] != 1 || header[1] != Features || header[2] != Hidden || header[3] != L1)
+            return false;
+
+        Network n;
+        read(fin, n.ft_weight);
+        read(fin, n.ft_bias);
+        read(fin, n.l1_weight);
+        read(fin, n.l1_bias);
+        read(fin, n.l2_weight);
+        fin.read(reinterpret_cast<char *>(&n.l2_bias), sizeof(n.l2_bias));
+        if (!fin)
+            return false;
+        n.loaded = true;
+        net() = move(n);
+        return true;
+    }
+
+    static bool loaded()
+    {
+        return net().loaded;
+    }
+
+  private:
+    struct Network
+    {
+        vector<int16_t> ft_weight = vector<int16_t>(Features * Hidden, 0);
+        vector<int16_t> ft_bias = vector<int16_t>(Hidden, 0);
+        vector<int8_t> l1_weight = vector<int8_t>(L1 * Hidden, 0);
+        vector<int32_t> l1_bias = vector<int32_t>(L1, 0);
+        vector<int8_t> l2_weight = vector<int8_t>(L1, 0);
+        int32_t l2_bias = 0;
+        bool loaded = false;
+    };
+
+    template <class T> static void read(ifstream &fin, vector<T> &v)
+    {
+        fin.read(reinterpret_cast<char *>(v.data()), v.size() * sizeof(T));
+    }
+
+    static Network &net()
+    {
+        static Network n;
+        return n;
+    }
+
+    static SCORE_T forward_generic(const int16_t *acc)
+    {
+        return forward_body(acc);
+    }
+
+    static void calc_batch_generic(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color)
+    {
+        calc_batch_body(pos, n, out, first_bot_color);
+    }
+
+#if CPU_DISPATCH_X86
+    CPU_TARGET("avx2") static SCORE_T forward_avx2(const int16_t *acc)
+    {
+        return forward_body(acc);
+    }
+
+    CPU_TARGET("avx2") static void calc_batch_avx2(const Packed_position *pos, const size_t n, SCORE_T *out,
+                                                   const bool first_bot_color)
+    {
+        calc_batch_body(pos, n, out, first_bot_color);
+    }
+#endif
+
+    // Выбранные при запуске реализации ядер
+    struct Kernels
+    {
+        SCORE_T (*forward)(const int16_t *) = &forward_generic;
+        void (*batch)(const Packed_position *, size_t, SCORE_T *, bool) = &calc_batch_generic;
+
+        Kernels()
+        {
+#if CPU_DISPATCH_X86
+            if (Cpu_features::get().use_avx2())
+            {
+                forward = &forward_avx2;
+                batch = &calc_batch_avx2;
+            }
+#endif
+        }
+    };
+
+    static const Kernels &kernels()
+    {
+        static const Kernels k;
+        return k;
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "../Models/Move.h"
+
+using namespace std;
+
+// Текстовая запись клеток и позиций.
+// Клетки — как на доске: столбцы a-h слева направо, ряды 1-8 снизу вверх со стороны белых,
+// поэтому клетка (i, j) доски — столбец 'a' + j, ряд 8 - i; a1 — тёмная клетка.
+// Позиция: "<кто ходит>:W<фигуры белых>:B<фигуры чёрных>", фигуры через запятую, K перед клеткой — дамка,
+// например "W:Wc3,Kd4:Bf6,Kh8" — ходят белые, у белых шашка c3 и дамка d4, у чёрных шашка f6 и дамка h8.
+class Notation
+{
+  public:
+    static string square_name(const POS_T i, const POS_T j)
+    {
+        return string(1, char('a' + j)) + char('8' - i);
+    }
+
+    // Клетка по имени ("c3"); false, если имя не клетка доски или клетка светлая
+    static bool parse_square(const string &name, POS_T &i, POS_T &j)
+    {
+        if (name.size() != 2)
+            return false;
+        const char col = char(tolower(name[0])), row = name[1];
+        if (col < 'a' || col > 'h' || row < '1' || row > '8')
+            return false;
+        i = POS_T('8' - row);
+        j = POS_T(col - 'a');
+        return (i + j) % 2 == 1;
+    }
+
+    // Разбирает позицию text в доску mtx и сторону, которая ходит (color: false — белые).
+    // false, если запись ошибочна: клетка занята дважды, светлая клетка или шашка на поле превращения.
+    static bool parse_position(const string &text, vector<vector<POS_T>> &mtx, bool &color)
+    {
+        mtx.assign(8, vector<POS_T>(8, 0));
+        string s;
+        for (const char c : text)
+            if (!isspace(static_cast<unsigned char>(c)))
+                s += c;
+        if (s.size() < 2 || (toupper(s[0]) != 'W' && toupper(s[0]) != 'B') || s[1] != ':')
+            return false;
+        color = toupper(s[0]) == 'B';
+
+        size_t pos = 2;
+        while (pos < s.size())
+        {
+            size_t end = s.find(':', pos);
+            if (end == string::npos)
+                end = s.size();
+            const string section = s.substr(pos, end - pos);
+            pos = end + 1;
+            if (section.empty() || (toupper(section[0]) != 'W' && toupper(section[0]) != 'B'))
+                return false;
+            const bool black = toupper(section[0]) == 'B';
+
+            size_t p = 1;
+            while (p < section.size())
+            {
+                size_t q = section.find(',', p);
+                if (q == string::npos)
+                    q = section.size();
+                string piece = section.substr(p, q - p);
+                p = q + 1;
+                if (piece.empty())
+                    continue;
+                const bool king = toupper(piece[0]) == 'K';
+                if (king)
+                    piece = piece.substr(1);
+                POS_T i, j;
+                if (!parse_square(piece, i, j) || mtx[i][j])
+                    return false;
+                // Шашка на последнем для неё ряду уже превратилась бы в дамку
+                if (!king && i == (black ? 7 : 0))
+                    return false;
+                mtx[i][j] = POS_T((black ? 2 : 1) + (king ? 2 : 0));
+            }
+        }
+        return true;
+    }
+
+    static string position_string(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        string res = color ? "B" : "W";
+        for (const int side : {0, 1})
+        {
+            res += side ? ":B" : ":W";
+            bool first = true;
+            for (POS_T i = 7; i >= 0; --i)
+            {
+                for (POS_T j = 0; j < 8; ++j)
+                {
+                    const POS_T piece = mtx[i][j];
+                    if (!piece || (piece % 2 == 0) != bool(side))
+                        continue;
+                    res += first ? "" : ",";
+                    res += (piece >= 3 ? "K" : "") + square_name(i, j);
+                    first = false;
+                }
+            }
+        }
+        return res;
+    }
+
+    // Запись полного хода (цепочки): клетки через "-" для тихого хода и через ":" для взятий, например
+    // "c3-d4" или "c3:e5:g3"
+    static string move_string(const vector<move_pos> &chain)
+    {
+        if (chain.empty())
+            return "";
+        string res = square_name(chain[0].x, chain[0].y);
+        for (const auto &turn : chain)
+            res += (turn.xb != -1 ? ":" : "-") + square_name(turn.x2, turn.y2);
+        return res;
+    }
+
+    // Номер хода из chains, записанного как text: клетки через "-", ":" или "x"; у взятия можно указать
+    // только начальную и конечную клетки ("c3:g3"), если это не путает его с другим ходом.
+    // -1, если запись ошибочна, такого хода нет или запись подходит нескольким ходам.
+    static int parse_move(const string &text, const vector<vector<move_pos>> &chains)
+    {
+        vector<pair<POS_T, POS_T>> squares;
+        size_t p = 0;
+        while (p <= text.size())
+        {
+            size_t q = text.find_first_of("-:xX", p);
+            if (q == string::npos)
+                q = text.size();
+            POS_T i, j;
+            if (!parse_square(text.substr(p, q - p), i, j))
+                return -1;
+            squares.emplace_back(i, j);
+            p = q + 1;
+        }
+        if (squares.size() < 2)
+            return -1;
+
+        int found = -1;
+        for (size_t k = 0; k < chains.size(); ++k)
+        {
+            const auto &chain = chains[k];
+            bool match = squares[0] == make_pair(chain[0].x, chain[0].y) &&
+                         squares.back() == make_pair(chain.back().x2, chain.back().y2);
+            // Полная запись цепочки должна совпасть клетка в клетку
+            if (match && squares.size() > 2)
+            {
+                match = squares.size() == chain.size() + 1;
+                for (size_t s = 1; match && s < chain.size(); ++s)
+                    match = squares[s] == make_pair(chain[s - 1].x2, chain[s - 1].y2);
+            }
+            if (!match)
+                continue;
+            if (found != -1)
+                return -1;
+            found = int(k);
+        }
+        return found;
+    }
+};
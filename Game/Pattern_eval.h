@@ -0,0 +1,263 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "Evaluators.h"
+
+using namespace std;
+
+// Слагаемые оценки по шаблонам: материальная часть (как у "NumberAndPotential") и битовые доски
+// шашек каждого цвета, из которых в листе собираются индексы шаблонов.
+struct Pattern_state : Material_state
+{
+    uint32_t men[2] = {0, 0};
+};
+
+// Оценка по шаблонам ("BotScoringType": "Patterns").
+// Доска разбита на 9 перекрывающихся блоков 4x4 (в каждом 8 тёмных клеток): углы, края, центр,
+// крайние ряды. Расположение шашек в блоке превращается в индекс (8 бит белых и 8 бит чёрных,
+// извлекаемых PEXT), индекс выбирает вес из таблицы блока. Сумма весов добавляется к материальной оценке.
+// Стоимость оценки — 9 извлечений и 9 обращений к таблице, сколько бы признаков ни было зашито в веса.
+// Веса загружаются из обученного файла (load), а без него строятся простые ручные признаки
+// (защищённые шашки, охрана своего крайнего ряда, центр).
+class Pattern_eval
+{
+  public:
+    typedef Pattern_state State;
+    typedef Number_and_potential_eval Material;
+    static const bool Cached = true;
+
+    static const int Regions = 9;
+    static const int Region_size = 1 << 16;
+
+    static void add(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        Material::add(st, piece, i, j);
+        if (piece <= 2)
+            st.men[piece - 1] |= 1u << square_of(i, j);
+    }
+
+    static void remove(State &st, const POS_T piece, const POS_T i, const POS_T j)
+    {
+        Material::remove(st, piece, i, j);
+        if (piece <= 2)
+            st.men[piece - 1] &= ~(1u << square_of(i, j));
+    }
+
+    static State init(const vector<vector<POS_T>> &mtx)
+    {
+        State st;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j])
+                    add(st, mtx[i][j], i, j);
+            }
+        }
+        return st;
+    }
+
+    // Сумма весов шаблонов с точки зрения белых.
+    // Реализация выбирается при запуске: с инструкцией PEXT, если процессор поддерживает BMI2, иначе переносимая.
+    static SCORE_T patterns_score(const uint32_t white_men, const uint32_t black_men)
+    {
+        return table().kernel(white_men, black_men);
+    }
+
+    static const char *kernel_name()
+    {
+        return table().kernel == &patterns_score_generic ? "generic" : "bmi2";
+    }
+
+    // first_bot_color — true, если бот играет за чёрных.
+    static SCORE_T calc_score(const State &st, const bool first_bot_color)
+    {
+        const SCORE_T material = Material::calc_score(st, first_bot_color);
+        if (material >= WIN_SCORE || material <= -WIN_SCORE)
+            return material;
+        const SCORE_T pat = patterns_score(st.men[0], st.men[1]);
+        return material + (first_bot_color ? -pat : pat);
+    }
+
+    static SCORE_T calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color)
+    {
+        return calc_score(init(mtx), first_bot_color);
+    }
+
+    // Дешёвая часть — материал; шаблоны меняют её не больше чем на lazy_margin()
+    static SCORE_T cheap_score(const State &st, const bool first_bot_color)
+    {
+        return Material::calc_score(st, first_bot_color);
+    }
+
+    // Пакетная оценка: материал считается по блокам позиций (Material::calc_batch),
+    // затем к каждой позиции добавляются веса шаблонов — выборки из таблиц, по одной на блок доски.
+    static void calc_batch(const Packed_position *pos, const size_t n, SCORE_T *out, const bool first_bot_color)
+    {
+        Material::calc_batch(pos, n, out, first_bot_color);
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (out[k] >= WIN_SCORE || out[k] <= -WIN_SCORE)
+                continue;
+            const SCORE_T pat = patterns_score(pos[k].bb[0], pos[k].bb[1]);
+            out[k] += first_bot_color ? -pat : pat;
+        }
+    }
+
+    // Сумма наибольших по модулю весов блоков — верхняя граница вклада шаблонов
+    static SCORE_T lazy_margin()
+    {
+        return table().margin;
+    }
+
+    // Загружает обученные веса. Формат файла (little-endian):
+    //   "CKPT", uint32 версия (1), uint32 число блоков (9), затем 9 * 65536 значений int16.
+    // Возвращает false (и оставляет ручные веса), если файла нет или формат не совпадает.
+    static bool load(const string &path)
+    {
+        ifstream fin(path, ios::binary);
+        char magic[4];
+        uint32_t version = 0, regions = 0;
+        if (!fin.read(magic, 4) || memcmp(magic, "CKPT", 4) != 0)
+            return false;
+        fin.read(reinterpret_cast<char *>(&version), 4);
+        fin.read(reinterpret_cast<char *>(&regions), 4);
+        if (!fin || version != 1 || regions != Regions)
+            return false;
+
+        vector<int16_t> weights(size_t(Regions) * Region_size);
+        if (!fin.read(reinterpret_cast<char *>(weights.data()), weights.size() * sizeof(int16_t)))
+            return false;
+        auto &t = table();
+        t.weight.assign(weights.begin(), weights.end());
+        t.update_margin();
+        return true;
+    }
+
+  private:
+    static SCORE_T patterns_score_generic(const uint32_t white_men, const uint32_t black_men)
+    {
+        const auto &t = table();
+        SCORE_T res = 0;
+        for (int r = 0; r < Regions; ++r)
+        {
+            const uint32_t index = pext32(white_men, t.mask[r]) | pext32(black_men, t.mask[r]) << 8;
+            res += t.weight[r * Region_size + index];
+        }
+        return res;
+    }
+
+#if CPU_DISPATCH_X86 || defined(_M_X64)
+    CPU_TARGET("bmi2") static SCORE_T patterns_score_bmi2(const uint32_t white_men, const uint32_t black_men)
+    {
+        const auto &t = table();
+        SCORE_T res = 0;
+        for (int r = 0; r < Regions; ++r)
+        {
+            const uint32_t index = pext32_bmi2(white_men, t.mask[r]) | pext32_bmi2(black_men, t.mask[r]) << 8;
+            res += t.weight[r * Region_size + index];
+        }
+        return res;
+    }
+#endif
+
+    struct Table
+    {
+        uint32_t mask[Regions];
+        vector<int16_t> weight = vector<int16_t>(size_t(Regions) * Region_size, 0);
+        SCORE_T margin = 0;
+        SCORE_T (*kernel)(uint32_t, uint32_t) = &patterns_score_generic;
+
+        Table()
+        {
+#if CPU_DISPATCH_X86 || defined(_M_X64)
+            if (Cpu_features::get().use_bmi2())
+                kernel = &patterns_score_bmi2;
+#endif
+            for (int r = 0; r < Regions; ++r)
+            {
+                const int row0 = r / 3 * 2, col0 = r % 3 * 2;
+                mask[r] = 0;
+                for (int i = row0; i < row0 + 4; ++i)
+                    for (int j = col0; j < col0 + 4; ++j)
+                        if ((i + j) % 2)
+                            mask[r] |= 1u << square_of(POS_T(i), POS_T(j));
+
+                for (uint32_t index = 0; index < Region_size; ++index)
+                {
+                    const uint32_t w = index & 0xFF, b = index >> 8;
+                    if (w & b)
+                        continue; // две шашки на одной клетке — индекс не встречается
+                    weight[r * Region_size + index] = int16_t(default_weight(mask[r], w, b));
+                }
+            }
+            update_margin();
+        }
+
+        void update_margin()
+        {
+            margin = 0;
+            for (int r = 0; r < Regions; ++r)
+            {
+                int max_abs = 0;
+                for (uint32_t index = 0; index < Region_size; ++index)
+                    max_abs = max(max_abs, abs(int(weight[r * Region_size + index])));
+                margin += max_abs;
+            }
+        }
+
+        // Ручные признаки для блока с маской mask и шашками w / b (биты в порядке клеток маски).
+        static int default_weight(uint32_t mask, const uint32_t w, const uint32_t b)
+        {
+            // Разворачиваем индекс обратно в клетки доски
+            uint32_t white = 0, black = 0;
+            for (uint32_t bit = 1; mask; bit <<= 1)
+            {
+                const uint32_t sq = mask & (0 - mask);
+                white |= (w & bit) ? sq : 0;
+                black |= (b & bit) ? sq : 0;
+                mask &= mask - 1;
+            }
+
+            int res = 0;
+            for (int sq = 0; sq < 32; ++sq)
+            {
+                const POS_T i = row_of(sq), j = col_of(sq);
+                const bool is_white = white >> sq & 1, is_black = black >> sq & 1;
+                if (!is_white && !is_black)
+                    continue;
+                const int sign = is_white ? 1 : -1;
+                const uint32_t own = is_white ? white : black;
+
+                // Шашка прикрыта сзади своей шашкой или краем доски
+                const POS_T back = is_white ? i + 1 : i - 1;
+                bool defended = back < 0 || back > 7 || j == 0 || j == 7;
+                for (POS_T dj = -1; dj <= 1 && !defended; dj += 2)
+                    defended = (own >> square_of(back, j + dj) & 1) != 0;
+                res += sign * (defended ? 2 : 0);
+
+                // Охрана своего крайнего ряда
+                if ((is_white && i == 7) || (is_black && i == 0))
+                    res += sign * 3;
+
+                // Центр доски
+                if (i >= 3 && i <= 4 && j >= 2 && j <= 5)
+                    res += sign * 3;
+            }
+            return res;
+        }
+    };
+
+    static Table &table()
+    {
+        static Table t;
+        return t;
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Evaluators.h"
+
+using namespace std;
+
+// Память поиска, которая переживает ходы: таблица транспозиций с лучшими ходами и оценками,
+// таблица истории отсечений, кэш оценок листьев и главный вариант последнего поиска.
+// У каждого цвета своя память (см. Logic::memory), поэтому в партии бот против бота
+// обе стороны сохраняют свои данные. Позиции адресуются ключом Зобриста, так что
+// после отката хода (Board::rollback) накопленные данные остаются верными.
+struct Search_memory
+{
+    // Тип оценки в записи таблицы: точная, нижняя или верхняя граница (или оценки нет — только ход).
+    enum Bound : int8_t
+    {
+        NONE,
+        EXACT,
+        LOWER,
+        UPPER
+    };
+
+    // Запись таблицы транспозиций: лучший ход и оценка, найденные в позиции key
+    // при поиске на depth ходов вперёд. Оценки побед хранятся относительно самой позиции.
+    struct tt_entry
+    {
+        uint64_t key = 0;
+        SCORE_T score = 0;
+        POS_T x = -1, y = -1, x2 = -1, y2 = -1;
+        int8_t depth = -1;
+        Bound bound = NONE;
+    };
+
+    // Запись кэша оценок: оценка оценщика за белых для расстановки фигур с ключом key.
+    struct eval_entry
+    {
+        uint64_t key = 0;
+        SCORE_T score = 0;
+    };
+
+    // size_mb — размер таблицы транспозиций, eval_kb — размер кэша оценок (0 — без кэша).
+    explicit Search_memory(const size_t size_mb = 16, const size_t eval_kb = 0)
+    {
+        size_t n = 1;
+        while (n * 2 * sizeof(tt_entry) <= size_mb * 1024 * 1024)
+            n *= 2;
+        tt.resize(n);
+        if (eval_kb)
+        {
+            n = 1;
+            while (n * 2 * sizeof(eval_entry) <= eval_kb * 1024)
+                n *= 2;
+            eval.resize(n);
+        }
+    }
+
+    // Возвращает запись для позиции key или nullptr, если позиции нет в таблице.
+    const tt_entry *probe(const uint64_t key) const
+    {
+        const auto &e = tt[key & (tt.size() - 1)];
+        return e.key == key && e.depth >= 0 ? &e : nullptr;
+    }
+
+    // Сохраняет лучший ход позиции и (если bound != NONE) её оценку, найденную на глубине ply от корня.
+    // Более глубокий результат для той же позиции не затирается.
+    void store(const uint64_t key, const move_pos &turn, const int depth, const SCORE_T score = 0,
+               const Bound bound = NONE, const int ply = 0)
+    {
+        auto &e = tt[key & (tt.size() - 1)];
+        if (e.key == key && e.depth > depth)
+            return;
+        e.key = key;
+        e.x = turn.x, e.y = turn.y, e.x2 = turn.x2, e.y2 = turn.y2;
+        e.depth = int8_t(depth);
+        e.bound = bound;
+        e.score = score;
+        if (score > WIN_BOUND)
+            e.score += ply;
+        else if (score < -WIN_BOUND)
+            e.score -= ply;
+        if (journal)
+            written.push_back(key & (tt.size() - 1));
+    }
+
+    // Оценка записи e для позиции на глубине ply от корня (см. store).
+    static SCORE_T score_of(const tt_entry &e, const int ply)
+    {
+        if (e.score > WIN_BOUND)
+            return e.score - ply;
+        if (e.score < -WIN_BOUND)
+            return e.score + ply;
+        return e.score;
+    }
+
+    // Ячейка кэша оценок для расстановки с ключом key (кэш с прямым отображением: при коллизии
+    // ячейка просто перезаписывается). Кэш не зависит от глубины и стороны, поэтому не стареет.
+    eval_entry &eval_of(const uint64_t key)
+    {
+        return eval[key & (eval.size() - 1)];
+    }
+
+    // Сколько раз ход (x, y) -> (x2, y2) давал отсечение, с весом по оставшейся глубине.
+    int &history_of(const move_pos &turn)
+    {
+        return history[(turn.x * 8 + turn.y) * 64 + turn.x2 * 8 + turn.y2];
+    }
+
+    // Старение истории перед новым поиском, чтобы старые отсечения постепенно теряли вес.
+    void age()
+    {
+        for (auto &h : history)
+            h /= 2;
+    }
+
+    // Копия для потока параллельного поиска: запоминает, какие записи таблицы и насколько историю
+    // он изменил. Делается один раз на поиск, после каждой итерации изменения вливаются через merge().
+    Search_memory fork() const
+    {
+        Search_memory res(*this);
+        res.journal = true;
+        res.written.clear();
+        res.base_history = history;
+        return res;
+    }
+
+    // Вливает изменения копии worker (см. fork()) со времени прошлого слияния и начинает её журнал
+    // заново. Вызывается для потоков строго по порядку, поэтому итог не зависит от планировщика.
+    void merge(Search_memory &worker)
+    {
+        for (const auto i : worker.written)
+        {
+            const auto &e = worker.tt[i];
+            if (tt[i].key != e.key || tt[i].depth <= e.depth)
+                tt[i] = e;
+        }
+        for (size_t i = 0; i < history.size(); ++i)
+            history[i] += worker.history[i] - worker.base_history[i];
+        worker.written.clear();
+        worker.base_history = worker.history;
+    }
+
+    vector<tt_entry> tt;
+    vector<eval_entry> eval;
+    vector<int> history = vector<int>(64 * 64, 0);
+
+    // Журнал изменённых записей и история на момент прошлого слияния (только у копий для потоков, см. fork()).
+    bool journal = false;
+    vector<size_t> written;
+    vector<int> base_history;
+};
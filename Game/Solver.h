@@ -0,0 +1,349 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "Bitbase.h"
+#include "Hash.h"
+#include "Tablebase.h"
+
+using namespace std;
+
+// Доказанный результат позиции для стороны, которая ходит.
+// Unknown — бюджет узлов исчерпан раньше, чем результат доказан.
+enum class Proof_result
+{
+    Win,
+    Loss,
+    Draw,
+    Unknown
+};
+
+// Итог работы решателя: результат, число посещённых узлов, размер дерева доказательства
+// (различных позиций в нём), заполненность таблицы и время.
+struct Solver_report
+{
+    Proof_result result = Proof_result::Unknown;
+    uint64_t nodes = 0;
+    uint64_t proof_size = 0;
+    uint64_t tt_used = 0, tt_size = 0;
+    double seconds = 0;
+};
+
+// Решатель позиций поиском по числам доказательства в глубину (df-pn).
+// Move_gen — генератор ходов Logic (find_full_turns, make_turn), как у Tablebase_generator.
+//
+// Вопрос "может ли атакующая сторона выиграть не более чем за plies полуходов" решается df-pn:
+// у каждой позиции есть число доказательства φ (сколько листьев нужно доказать, чтобы ходящий добился
+// своей цели) и опровержения δ; φ(позиции) = min δ(после хода), δ(позиции) = Σ φ(после хода).
+// Поиск спускается в ход с наименьшим δ, пока числа не превысят порогов, и хранит φ/δ в таблице
+// фиксированного размера (бюджет памяти): потерянные при вытеснении записи просто считаются заново.
+// Цель атакующего — выиграть, защищающегося — не проиграть. Ничья наступает, когда полуходы кончились
+// (правило "MaxNumTurns"), поэтому в ключ позиции входит их остаток и повторений позиций в дереве нет.
+// Правило "KingMovesDraw" (king_moves_draw полуходов подряд только дамками без взятий — ничья) тоже
+// учитывается: остаток таких полуходов входит в ключ, в корне счёт начинается заново.
+// Троекратное повторение не моделируется: в редких случаях защищающийся в игре может добиться ничьей
+// повторением там, где решатель доказал выигрыш.
+// Результат: выигрыш ходящего, если доказан его выигрыш; проигрыш, если доказан выигрыш соперника;
+// ничья, если оба опровергнуты.
+// Листья с малым числом фигур решаются по битовым и файловым базам: ничья в базе — ничья при любом
+// остатке полуходов, выигрыш в базе за d полуходов — выигрыш, если d меньше остатка.
+template <class Move_gen> class Pn_solver
+{
+  public:
+    // mb — память таблицы в мегабайтах, max_nodes — предел узлов (0 — без предела)
+    // king_moves_draw — правило "KingMovesDraw" (0 — выключено)
+    Pn_solver(Move_gen &logic, const size_t mb, const uint64_t max_nodes, const Bitbase *bitbase,
+              Tablebase *tablebase, const int king_moves_draw = 0)
+        : logic(logic), max_nodes(max_nodes), bitbase(bitbase), tablebase(tablebase),
+          king_moves_draw(king_moves_draw)
+    {
+        size_t n = 1;
+        while (n * 2 * sizeof(Entry) <= max<size_t>(1, mb) * 1024 * 1024)
+            n *= 2;
+        table.resize(n);
+    }
+
+    Solver_report solve(const vector<vector<POS_T>> &mtx, const bool color, const int plies)
+    {
+        const auto start = chrono::steady_clock::now();
+        Solver_report rep;
+        rep.tt_size = table.size();
+        nodes = 0;
+
+        Proof_result result = Proof_result::Unknown;
+        // Сначала — может ли выиграть ходящий, затем — может ли выиграть соперник
+        for (const bool attacker_moves : {true, false})
+        {
+            clear();
+            const Node root{mtx, color, plies, king_moves_draw, attacker_moves};
+            mid(root, Infinity - 1, Infinity - 1);
+            const Entry e = lookup(root);
+            if (e.phi != 0 && e.delta != 0)
+                break; // бюджет исчерпан
+            const bool attacker_wins = attacker_moves ? e.phi == 0 : e.delta == 0;
+            if (attacker_wins)
+            {
+                result = attacker_moves ? Proof_result::Win : Proof_result::Loss;
+                rep.proof_size = proof_size(root);
+                break;
+            }
+            if (!attacker_moves)
+            {
+                result = Proof_result::Draw;
+                rep.proof_size = proof_size(root);
+            }
+        }
+
+        rep.result = result;
+        rep.nodes = nodes;
+        for (const auto &e : table)
+            rep.tt_used += e.key != 0;
+        rep.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return rep;
+    }
+
+  private:
+    static const uint32_t Infinity = 1u << 30;
+
+    struct Node
+    {
+        vector<vector<POS_T>> mtx;
+        bool color;
+        int plies;          // полуходов до ничьей
+        int kings;          // полуходов до ничьей по "KingMovesDraw" (если правило включено)
+        bool attacker;      // ходит ли атакующая сторона
+    };
+
+    struct Entry
+    {
+        uint64_t key = 0;
+        uint32_t phi = 1, delta = 1;
+        uint32_t work = 0; // узлов, потраченных на запись (для вытеснения)
+    };
+
+    // df-pn: углубляет позицию n, пока её числа не превысят пороги th_phi / th_delta
+    void mid(const Node &n, const uint32_t th_phi, const uint32_t th_delta)
+    {
+        const uint64_t nodes_before = nodes++;
+        Entry e = lookup(n);
+        if (e.phi == 0 || e.delta == 0)
+            return;
+
+        vector<Node> children;
+        for (const auto &chain : logic.find_full_turns(n.mtx, n.color))
+            children.push_back(child(n, chain));
+        if (children.empty())
+        {
+            // Ходов нет — ходящий проиграл, его цель недостижима
+            store(n, Infinity, 0, 1);
+            return;
+        }
+
+        while (true)
+        {
+            uint32_t phi = Infinity, delta = 0;
+            size_t best = 0;
+            uint32_t best_delta = Infinity, second_delta = Infinity, best_phi = 0;
+            for (size_t k = 0; k < children.size(); ++k)
+            {
+                const Entry c = lookup(children[k]);
+                phi = min(phi, c.delta);
+                delta = capped(uint64_t(delta) + c.phi);
+                if (c.delta < best_delta)
+                {
+                    second_delta = best_delta;
+                    best_delta = c.delta;
+                    best_phi = c.phi;
+                    best = k;
+                }
+                else if (c.delta < second_delta)
+                    second_delta = c.delta;
+            }
+            if (phi >= th_phi || delta >= th_delta || out_of_budget())
+            {
+                store(n, phi, delta, uint32_t(min<uint64_t>(nodes - nodes_before, UINT32_MAX)));
+                return;
+            }
+            // Пороги хода: его φ не должно съесть запас δ позиции, его δ — превысить второй по δ ход
+            const uint32_t child_th_phi = capped(uint64_t(th_delta) - delta + best_phi);
+            const uint32_t child_th_delta = min(th_phi, second_delta + 1);
+            mid(children[best], child_th_phi, child_th_delta);
+        }
+    }
+
+    // Позиция после хода chain из n: ход шашкой или взятие начинает счёт "KingMovesDraw" заново
+    Node child(const Node &n, const vector<move_pos> &chain) const
+    {
+        auto mtx2 = n.mtx;
+        bool irreversible = n.mtx[chain[0].x][chain[0].y] <= 2;
+        for (const auto &turn : chain)
+        {
+            irreversible |= turn.xb != -1;
+            mtx2 = logic.make_turn(mtx2, turn);
+        }
+        return {move(mtx2), !n.color, n.plies - 1, irreversible ? king_moves_draw : n.kings - 1, !n.attacker};
+    }
+
+    // Ничья по числу ходов: кончились полуходы "MaxNumTurns" или "KingMovesDraw"
+    bool rule_draw(const Node &n) const
+    {
+        return n.plies <= 0 || (king_moves_draw && n.kings <= 0);
+    }
+
+    static uint32_t capped(const uint64_t x)
+    {
+        return x < Infinity ? uint32_t(x) : Infinity;
+    }
+
+    bool out_of_budget() const
+    {
+        return max_nodes && nodes >= max_nodes;
+    }
+
+    uint64_t key_of(const Node &n) const
+    {
+        // Остатки полуходов и роль ходящего — часть позиции
+        uint64_t x = uint64_t(n.plies) * 2 + n.attacker + (uint64_t(king_moves_draw ? n.kings : 0) << 32) +
+                     0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        // Числа φ/δ — с точки зрения ходящего, поэтому отражённая позиция делит запись с исходной
+        return (Zobrist::canonical_key(n.mtx, n.color) ^ x ^ (x >> 31)) | 1; // 0 — пустая запись
+    }
+
+    // φ/δ позиции n: из таблицы, по правилу ничьей и базам или начальные (1, 1)
+    Entry lookup(const Node &n)
+    {
+        const uint64_t key = key_of(n);
+        Entry *slots = bucket(key);
+        for (int s = 0; s < 2; ++s)
+            if (slots[s].key == key)
+                return slots[s];
+
+        Entry res;
+        res.key = key;
+        int known = 0; // 1 — цель ходящего достигнута, -1 — недостижима
+        if (rule_draw(n))
+            known = n.attacker ? -1 : 1; // ничья по числу ходов
+        else
+            known = probe_bases(n);
+        if (known)
+        {
+            res.phi = known > 0 ? 0 : Infinity;
+            res.delta = known > 0 ? Infinity : 0;
+            store(n, res.phi, res.delta, 0);
+        }
+        return res;
+    }
+
+    // Итог позиции по базам с точки зрения цели ходящего (0 — базы не знают итога в пределах остатка)
+    int probe_bases(const Node &n)
+    {
+        int pieces = 0, men = 0;
+        for (const auto &row : n.mtx)
+        {
+            for (const POS_T p : row)
+            {
+                pieces += p != 0;
+                men += p == 1 || p == 2;
+            }
+        }
+
+        uint8_t wdl = Bitbase::INVALID;
+        if (bitbase && pieces <= Bitbase::Pieces && bitbase->probe(n.mtx, n.color, wdl))
+        {
+            if (wdl == Bitbase::DRAW)
+                return n.attacker ? -1 : 1;
+            // Выигрыш ходящего — защищающийся не проиграет; проигрыш — атакующий не выиграет
+            if (wdl == Bitbase::WIN && !n.attacker)
+                return 1;
+            if (wdl == Bitbase::LOSS && n.attacker)
+                return -1;
+        }
+
+        uint8_t v;
+        if (tablebase && pieces <= tablebase->pieces() && tablebase->probe(n.mtx, n.color, v))
+        {
+            if (v == Tb::DRAW)
+                return n.attacker ? -1 : 1;
+            // Выигрыш по базе за d полуходов форсирован: следуя базе, выигрывающий укладывается в d,
+            // и позиция без ходов у проигравшего должна наступить раньше ничьей по числу ходов
+            // (с одними дамками — и раньше ничьей по "KingMovesDraw", взятия по пути не учитываются)
+            const bool in_time =
+                Tb::distance(v) < n.plies && (!king_moves_draw || men || Tb::distance(v) < n.kings);
+            if (Tb::is_win(v))
+                return !n.attacker || in_time ? 1 : 0;
+            return n.attacker || in_time ? -1 : 0;
+        }
+        return 0;
+    }
+
+    Entry *bucket(const uint64_t key)
+    {
+        return &table[(key >> 1) & (table.size() - 2)];
+    }
+
+    // Запись в корзину из двух мест: первое хранит запись с большей работой, второе заменяется всегда
+    void store(const Node &n, const uint32_t phi, const uint32_t delta, const uint32_t work)
+    {
+        const uint64_t key = key_of(n);
+        Entry *slots = bucket(key);
+        Entry e{key, phi, delta, work};
+        if (slots[0].key == key || slots[0].key == 0 || work >= slots[0].work)
+        {
+            if (slots[0].key != key && slots[0].key != 0)
+                slots[1] = slots[0];
+            slots[0] = e;
+        }
+        else
+            slots[1] = e;
+    }
+
+    void clear()
+    {
+        fill(table.begin(), table.end(), Entry{});
+    }
+
+    // Число различных позиций дерева доказательства: у доказанной позиции — один ход с опровергнутым
+    // ответом, у опровергнутой — все ходы. Вытесненные из таблицы записи считаются одной позицией.
+    uint64_t proof_size(const Node &root)
+    {
+        unordered_set<uint64_t> seen;
+        vector<Node> stack{root};
+        while (!stack.empty())
+        {
+            const Node n = move(stack.back());
+            stack.pop_back();
+            if (!seen.insert(key_of(n)).second)
+                continue;
+            const Entry e = lookup(n);
+            if (rule_draw(n) || probe_bases(n) != 0)
+                continue;
+            for (const auto &chain : logic.find_full_turns(n.mtx, n.color))
+            {
+                const Node c = child(n, chain);
+                const Entry ce = lookup(c);
+                if (e.phi == 0 && ce.delta == 0)
+                {
+                    stack.push_back(c); // достаточно одного хода
+                    break;
+                }
+                if (e.delta == 0 && ce.phi == 0)
+                    stack.push_back(c);
+            }
+        }
+        return seen.size();
+    }
+
+    Move_gen &logic;
+    uint64_t max_nodes;
+    const Bitbase *bitbase;
+    Tablebase *tablebase;
+    int king_moves_draw;
+    vector<Entry> table;
+    uint64_t nodes = 0;
+};
@@ -0,0 +1,507 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Models/Bitboard.h"
+#include "../Models/Mapped_file.h"
+
+using namespace std;
+
+// Эндшпильные базы: результат (выигрыш/ничья/проигрыш и число полуходов до конца) каждой позиции
+// с небольшим числом фигур. Базы строит утилита Tools/Tablebase_gen.cpp ретроградным анализом.
+//
+// Позиции разбиты на классы по соотношению материала (белые шашки, белые дамки, чёрные шашки,
+// чёрные дамки). Хранятся только позиции с ходом белых: позиция с ходом чёрных после обмена цветов
+// с поворотом доски (flip_colors) — позиция с ходом белых класса с переставленным материалом.
+//
+// Номер позиции в классе комбинаторный: каждая группа фигур (белые шашки, чёрные шашки, белые дамки,
+// чёрные дамки) — сочетание клеток из разрешённых для неё (белые шашки не стоят на 0-м ряду, чёрные —
+// на 7-м), номер сочетания — в комбинаторной системе счисления. Номера, где группы пересекаются, недопустимы.
+
+// Значение позиции в базе (один байт):
+//   0 — ничья, 1 — недопустимый номер, 2 + 2d — ходящий выигрывает за d полуходов, 3 + 2d — проигрывает.
+// d насыщается на Max_distance.
+struct Tb
+{
+    static const uint8_t DRAW = 0;
+    static const uint8_t INVALID = 1;
+    static const int Max_distance = 126;
+
+    static uint8_t win(const int d)
+    {
+        return uint8_t(2 + 2 * (d < Max_distance ? d : Max_distance));
+    }
+
+    static uint8_t loss(const int d)
+    {
+        return uint8_t(3 + 2 * (d < Max_distance ? d : Max_distance));
+    }
+
+    static bool is_win(const uint8_t v)
+    {
+        return v >= 2 && v % 2 == 0;
+    }
+
+    static bool is_loss(const uint8_t v)
+    {
+        return v >= 2 && v % 2 == 1;
+    }
+
+    static int distance(const uint8_t v)
+    {
+        return (v - 2) / 2;
+    }
+};
+
+// Класс материала позиции с ходом белых.
+struct Tb_material
+{
+    int wm = 0, wk = 0, bm = 0, bk = 0;
+
+    static Tb_material of(const Packed_position &pos)
+    {
+        return {popcount32(pos.bb[0]), popcount32(pos.bb[2]), popcount32(pos.bb[1]), popcount32(pos.bb[3])};
+    }
+
+    int pieces() const
+    {
+        return wm + wk + bm + bk;
+    }
+
+    int men() const
+    {
+        return wm + bm;
+    }
+
+    Tb_material flipped() const
+    {
+        return {bm, bk, wm, wk};
+    }
+
+    bool operator==(const Tb_material &o) const
+    {
+        return wm == o.wm && wk == o.wk && bm == o.bm && bk == o.bk;
+    }
+
+    bool operator<(const Tb_material &o) const
+    {
+        if (pieces() != o.pieces())
+            return pieces() < o.pieces();
+        if (men() != o.men())
+            return men() < o.men();
+        return name() < o.name();
+    }
+
+    // Имя файла базы, например "1201" — 1 белая шашка, 2 белые дамки, 0 чёрных шашек, 1 чёрная дамка
+    string name() const
+    {
+        return to_string(wm) + to_string(wk) + to_string(bm) + to_string(bk);
+    }
+
+    // Все классы, где у каждой стороны есть фигуры и всего фигур не больше max_pieces, в порядке решения
+    static vector<Tb_material> classes(const int max_pieces)
+    {
+        vector<Tb_material> res;
+        for (int wm = 0; wm <= max_pieces; ++wm)
+            for (int wk = 0; wm + wk <= max_pieces; ++wk)
+                for (int bm = 0; wm + wk + bm <= max_pieces; ++bm)
+                    for (int bk = 0; wm + wk + bm + bk <= max_pieces; ++bk)
+                        if (wm + wk > 0 && bm + bk > 0)
+                            res.push_back({wm, wk, bm, bk});
+        sort(res.begin(), res.end());
+        return res;
+    }
+
+    // Число номеров в классе (включая недопустимые)
+    uint64_t size() const
+    {
+        return binomial(28, wm) * binomial(28, bm) * binomial(32, wk) * binomial(32, bk);
+    }
+
+    // Номер позиции pos (материал pos должен совпадать с классом)
+    uint64_t index(const Packed_position &pos) const
+    {
+        uint64_t res = rank(pos.bb[0] >> 4);
+        res = res * binomial(28, bm) + rank(pos.bb[1]);
+        res = res * binomial(32, wk) + rank(pos.bb[2]);
+        res = res * binomial(32, bk) + rank(pos.bb[3]);
+        return res;
+    }
+
+    // Позиция по номеру; false, если номер недопустим (группы фигур пересекаются)
+    bool position(uint64_t index, Packed_position &pos) const
+    {
+        const uint64_t nbk = binomial(32, bk), nwk = binomial(32, wk), nbm = binomial(28, bm);
+        pos.bb[3] = unrank(index % nbk, bk);
+        index /= nbk;
+        pos.bb[2] = unrank(index % nwk, wk);
+        index /= nwk;
+        pos.bb[1] = unrank(index % nbm, bm);
+        index /= nbm;
+        pos.bb[0] = unrank(index, wm) << 4;
+        const uint32_t all = pos.bb[0] | pos.bb[1] | pos.bb[2] | pos.bb[3];
+        return popcount32(all) == pieces();
+    }
+
+    static uint64_t binomial(const int n, const int k)
+    {
+        static const auto table = [] {
+            vector<vector<uint64_t>> c(33, vector<uint64_t>(33, 0));
+            for (int i = 0; i <= 32; ++i)
+            {
+                c[i][0] = 1;
+                for (int j = 1; j <= i; ++j)
+                    c[i][j] = c[i - 1][j - 1] + c[i - 1][j];
+            }
+            return c;
+        }();
+        return k < 0 || k > n ? 0 : table[n][k];
+    }
+
+  private:
+    // Номер сочетания клеток (биты bits) в комбинаторной системе: сумма C(s_i, i) по возрастанию клеток
+    static uint64_t rank(uint32_t bits)
+    {
+        uint64_t res = 0;
+        for (int i = 1; bits; ++i, bits &= bits - 1)
+            res += binomial(popcount32((bits & (0 - bits)) - 1), i);
+        return res;
+    }
+
+    static uint32_t unrank(uint64_t r, const int k)
+    {
+        uint32_t bits = 0;
+        int s = 31;
+        for (int i = k; i >= 1; --i)
+        {
+            while (binomial(s, i) > r)
+                --s;
+            bits |= 1u << s;
+            r -= binomial(s, i);
+            --s;
+        }
+        return bits;
+    }
+};
+
+// Файл базы одного класса материала (little-endian):
+//   "CKTB", uint32 версия (2), 4 байта материала (wm, wk, bm, bk), uint64 число позиций,
+//   uint32 размер блока (позиций), uint32 число блоков, (блоки + 1) смещений uint64 блоков в области данных,
+//   затем блоки. Значения позиций идут по номерам, каждые Block_size позиций сжаты отдельно,
+//   поэтому для чтения одной позиции достаточно распаковать один блок.
+// Сжатие блока — LZ77 по байтам: управляющий байт c < 128 — следуют c + 1 байт как есть,
+// c >= 128 — повтор c - 125 байт (3..130), начинающихся на uint16 байт раньше.
+// Недопустимые номера при сжатии заменяются предыдущим значением (поиск их не читает), так что
+// серии ничьих и выигрышей не рвутся. Базы 4 фигур сжимаются примерно в 2.3 раза.
+struct Tb_file
+{
+    static const uint32_t Version = 2;
+    static const uint32_t Block_size = 4096;
+    static const size_t Header_size = 28;
+
+    static string file_name(const string &dir, const Tb_material &m)
+    {
+        return dir + "/" + m.name() + ".cktb";
+    }
+
+    static bool save(const string &path, const Tb_material &m, const vector<uint8_t> &values)
+    {
+        const uint32_t block_size = Block_size;
+        const uint32_t blocks = uint32_t((values.size() + block_size - 1) / block_size);
+        vector<uint64_t> offsets(size_t(blocks) + 1, 0);
+        vector<uint8_t> data, block;
+        uint8_t last = Tb::DRAW;
+        for (uint32_t b = 0; b < blocks; ++b)
+        {
+            const size_t begin = size_t(b) * block_size, end = min(values.size(), begin + block_size);
+            block.clear();
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (values[i] != Tb::INVALID)
+                    last = values[i];
+                block.push_back(last);
+            }
+            pack_block(block, data);
+            offsets[b + 1] = data.size();
+        }
+
+        ofstream fout(path, ios::binary | ios::trunc);
+        const uint8_t material[4] = {uint8_t(m.wm), uint8_t(m.wk), uint8_t(m.bm), uint8_t(m.bk)};
+        const uint32_t version = Version;
+        const uint64_t count = values.size();
+        fout.write("CKTB", 4);
+        fout.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        fout.write(reinterpret_cast<const char *>(material), sizeof(material));
+        fout.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        fout.write(reinterpret_cast<const char *>(&block_size), sizeof(block_size));
+        fout.write(reinterpret_cast<const char *>(&blocks), sizeof(blocks));
+        fout.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        fout.write(reinterpret_cast<const char *>(data.data()), data.size());
+        return bool(fout);
+    }
+
+    // Сжимает блок in в конец out: жадный LZ77, кандидаты повторов — цепочки позиций с теми же 3 байтами
+    static void pack_block(const vector<uint8_t> &in, vector<uint8_t> &out)
+    {
+        const int Max_chain = 16, Min_match = 3, Max_match = 130, Max_literals = 128;
+        const size_t n = in.size();
+        vector<int> head(1 << 12, -1), prev_pos(n, -1);
+        auto hash = [&](const size_t i) { return (in[i] * 0x9E5u + in[i + 1] * 0x3Bu + in[i + 2]) & 0xFFF; };
+        auto insert = [&](const size_t i) {
+            if (i + Min_match > n)
+                return;
+            const auto h = hash(i);
+            prev_pos[i] = head[h];
+            head[h] = int(i);
+        };
+
+        size_t literals = 0; // литералы, ещё не записанные перед in[i]
+        auto flush = [&](const size_t i) {
+            for (size_t start = i - literals; start < i; start += Max_literals)
+            {
+                const size_t len = min<size_t>(Max_literals, i - start);
+                out.push_back(uint8_t(len - 1));
+                out.insert(out.end(), in.begin() + start, in.begin() + start + len);
+            }
+            literals = 0;
+        };
+
+        for (size_t i = 0; i < n;)
+        {
+            size_t best_len = 0, best_dist = 0;
+            if (i + Min_match <= n)
+            {
+                int c = head[hash(i)];
+                for (int chain = 0; c >= 0 && chain < Max_chain; c = prev_pos[c], ++chain)
+                {
+                    size_t len = 0;
+                    while (i + len < n && len < size_t(Max_match) && in[c + len] == in[i + len])
+                        ++len;
+                    if (len > best_len)
+                        best_len = len, best_dist = i - c;
+                }
+            }
+            if (best_len >= size_t(Min_match))
+            {
+                flush(i);
+                out.push_back(uint8_t(128 + best_len - Min_match));
+                out.push_back(uint8_t(best_dist & 0xFF));
+                out.push_back(uint8_t(best_dist >> 8));
+                for (size_t k = i; k < i + best_len; ++k)
+                    insert(k);
+                i += best_len;
+            }
+            else
+            {
+                insert(i);
+                ++literals;
+                ++i;
+            }
+        }
+        flush(n);
+    }
+
+    // Распаковывает блок src..src_end в out (n значений); false, если блок повреждён
+    static bool unpack_block(const uint8_t *src, const uint8_t *src_end, uint8_t *out, const size_t n)
+    {
+        size_t filled = 0;
+        while (src < src_end)
+        {
+            const uint8_t c = *src++;
+            if (c < 128)
+            {
+                const size_t len = size_t(c) + 1;
+                if (len > size_t(src_end - src) || filled + len > n)
+                    return false;
+                memcpy(out + filled, src, len);
+                src += len;
+                filled += len;
+            }
+            else
+            {
+                const size_t len = size_t(c) - 125;
+                if (src_end - src < 2)
+                    return false;
+                const size_t dist = size_t(src[0]) | size_t(src[1]) << 8;
+                src += 2;
+                if (dist == 0 || dist > filled || filled + len > n)
+                    return false;
+                // Источник может перекрываться с приёмником (серии) — копируем побайтно
+                for (size_t k = 0; k < len; ++k, ++filled)
+                    out[filled] = out[filled - dist];
+            }
+        }
+        return filled == n;
+    }
+};
+
+// Чтение эндшпильных баз во время поиска.
+// Файлы отображаются в память (Mapped_file) при создании — это почти бесплатно, с диска читаются
+// только блоки, к которым обращается поиск. Распакованные блоки хранятся в кэше с вытеснением
+// давно не использованных (LRU), размер кэша ограничен cache_mb мегабайтами.
+// Один объект делят все копии Logic (потоки поиска, обдумывание), кэш защищён мьютексом.
+class Tablebase
+{
+  public:
+    // Больше фигур базы не ищутся
+    static const int Max_pieces = 8;
+
+    Tablebase(const string &dir, const size_t cache_mb)
+        : capacity(max<size_t>(1, cache_mb * 1024 * 1024 / Tb_file::Block_size))
+    {
+        // Число фигур базы — наибольшее n, для которого есть файлы всех классов до n фигур включительно
+        for (int n = 2; n <= Max_pieces; ++n)
+        {
+            bool complete = true;
+            for (const auto &m : Tb_material::classes(n))
+            {
+                if (m.pieces() != n || files.count(id(m)))
+                    continue;
+                auto f = make_unique<File>();
+                if (!f->open(Tb_file::file_name(dir, m), m))
+                {
+                    complete = false;
+                    break;
+                }
+                files[id(m)] = move(f);
+            }
+            if (!complete)
+                break;
+            max_pieces = n;
+        }
+    }
+
+    // Наибольшее число фигур, для которого базы есть (0 — баз нет)
+    int pieces() const
+    {
+        return max_pieces;
+    }
+
+    // Значение позиции pos с ходом белых (см. Tb); false, если базы её класса нет или файл повреждён.
+    // Для недопустимых номеров значение не определено (при сжатии они заменены соседними)
+    bool probe(const Packed_position &pos, uint8_t &value)
+    {
+        const Tb_material m = Tb_material::of(pos);
+        if (m.pieces() > max_pieces)
+            return false;
+        const auto it = files.find(id(m));
+        if (it == files.end())
+            return false;
+        const File &f = *it->second;
+        const uint64_t index = m.index(pos);
+        if (index >= f.count)
+            return false;
+        const uint64_t block = index / f.block_size;
+        const uint64_t key = uint64_t(id(m)) << 40 | block;
+
+        lock_guard<mutex> guard(lock);
+        auto c = cached.find(key);
+        if (c == cached.end())
+        {
+            // Распаковываем блок на место самого давно использованного
+            if (lru.size() < capacity)
+                lru.emplace_front();
+            else
+            {
+                cached.erase(lru.back().key);
+                lru.splice(lru.begin(), lru, prev(lru.end()));
+            }
+            Block &b = lru.front();
+            b.key = key;
+            if (!f.read_block(block, b.values))
+            {
+                lru.pop_front();
+                return false;
+            }
+            c = cached.emplace(key, lru.begin()).first;
+        }
+        else
+            lru.splice(lru.begin(), lru, c->second);
+        value = c->second->values[index % f.block_size];
+        return true;
+    }
+
+    // Значение позиции mtx, где ходит color (0 — белые), с точки зрения ходящего
+    bool probe(const vector<vector<POS_T>> &mtx, const bool color, uint8_t &value)
+    {
+        const Packed_position pos = pack(mtx);
+        return probe(canonical(pos, color), value);
+    }
+
+  private:
+    struct File
+    {
+        Mapped_file map;
+        uint64_t count = 0;
+        uint32_t block_size = 0, blocks = 0;
+        const uint8_t *offsets = nullptr, *data = nullptr;
+        size_t data_size = 0;
+
+        bool open(const string &path, const Tb_material &m)
+        {
+            if (!map.open(path) || map.size() < Tb_file::Header_size)
+                return false;
+            const uint8_t *p = map.data();
+            uint32_t version = 0;
+            memcpy(&version, p + 4, 4);
+            memcpy(&count, p + 12, 8);
+            memcpy(&block_size, p + 20, 4);
+            memcpy(&blocks, p + 24, 4);
+            const uint8_t material[4] = {uint8_t(m.wm), uint8_t(m.wk), uint8_t(m.bm), uint8_t(m.bk)};
+            if (memcmp(p, "CKTB", 4) != 0 || version != Tb_file::Version || memcmp(p + 8, material, 4) != 0 ||
+                count != m.size() || block_size == 0 || blocks != (count + block_size - 1) / block_size)
+                return false;
+            const size_t index_size = (size_t(blocks) + 1) * sizeof(uint64_t);
+            if (map.size() < Tb_file::Header_size + index_size)
+                return false;
+            offsets = p + Tb_file::Header_size;
+            data = offsets + index_size;
+            data_size = map.size() - Tb_file::Header_size - index_size;
+            return offset(blocks) == data_size;
+        }
+
+        uint64_t offset(const uint64_t block) const
+        {
+            uint64_t res;
+            memcpy(&res, offsets + block * sizeof(uint64_t), sizeof(res));
+            return res;
+        }
+
+        bool read_block(const uint64_t block, vector<uint8_t> &values) const
+        {
+            const uint64_t begin = offset(block), end = offset(block + 1);
+            if (begin > end || end > data_size)
+                return false;
+            const size_t n = size_t(min<uint64_t>(block_size, count - block * block_size));
+            values.resize(n);
+            return Tb_file::unpack_block(data + begin, data + end, values.data(), n);
+        }
+    };
+
+    struct Block
+    {
+        uint64_t key = 0;
+        vector<uint8_t> values;
+    };
+
+    static int id(const Tb_material &m)
+    {
+        return ((m.wm * 13 + m.wk) * 13 + m.bm) * 13 + m.bk;
+    }
+
+    int max_pieces = 0;
+    unordered_map<int, unique_ptr<File>> files;
+
+    size_t capacity;
+    mutex lock;
+    list<Block> lru;
+    unordered_map<uint64_t, list<Block>::iterator> cached;
+};
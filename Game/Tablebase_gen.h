@@ -0,0 +1,237 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "Tablebase.h"
+
+using namespace std;
+
+// Генератор эндшпильных баз (используется утилитой Tools/Tablebase_gen.cpp и битовыми базами Bitbase.h).
+// Move_gen — класс с генератором ходов Logic: find_full_turns(mtx, color) и make_turn(mtx, turn);
+// параметр шаблона нужен, чтобы заголовок можно было подключить в Logic.h.
+//
+// Для каждого класса материала с числом фигур не больше заданного строит значения всех позиций
+// с ходом белых итеративным ретроградным анализом:
+//  1) классы решаются по возрастанию числа фигур, затем числа шашек — взятия и превращения ведут
+//     в уже решённые классы, а обычные ходы — только в тот же класс с переставленными цветами,
+//     поэтому класс и его зеркальный по цветам решаются вместе;
+//  2) ходы каждой позиции генерируются один раз (генератор ходов Logic, те же правила, что в игре:
+//     обязательное взятие, дамки на всю диагональ, превращение посреди взятия); ходы в решённые классы
+//     сразу сводятся к итогу, ходы внутри группы запоминаются номерами позиций;
+//  3) на каждом проходе нерешённая позиция смотрит значения позиций после своих ходов: есть ход в проигрыш
+//     соперника — выигрыш, все ходы в выигрыш соперника — проигрыш. Проход читает значения предыдущего
+//     прохода и пишет в новый буфер, поэтому потоки делят позиции между собой без блокировок,
+//     а результат не зависит от их числа;
+//  4) позиции, не решённые к моменту, когда проход ничего не меняет, — ничьи.
+// Число полуходов до конца не обязательно кратчайшее, но у выигрышной позиции всегда есть ход в проигрыш
+// соперника с меньшим числом — так бот по базе всегда продвигается к выигрышу.
+template <class Move_gen> class Tablebase_generator
+{
+  public:
+    // stop — флаг досрочной остановки (может быть nullptr): solve() тогда возвращает false
+    Tablebase_generator(const Move_gen &logic, const unsigned threads, const atomic<bool> *stop = nullptr)
+        : logic(logic), threads(max(1u, threads)), stop(stop)
+    {
+    }
+
+    // Печатать ли итог каждого класса
+    bool verbose = false;
+
+    // Решает класс m вместе с классом с переставленными цветами; false — генерацию остановили
+    bool solve(const Tb_material &m)
+    {
+        if (solved.count(m))
+            return true;
+        const auto start = chrono::steady_clock::now();
+        const Tb_material f = m.flipped();
+        group = {m};
+        if (!(f == m))
+            group.push_back(f);
+
+        vector<vector<uint8_t>> cur(group.size());
+        vector<vector<Part>> parts(group.size(), vector<Part>(threads));
+        for (size_t g = 0; g < group.size(); ++g)
+        {
+            cur[g].assign(group[g].size(), uint8_t(Tb::DRAW));
+            run_parallel(group[g], [&](const unsigned t, const uint64_t idx, Move_gen &worker) {
+                Part &part = parts[g][t];
+                part.begin.push_back(part.next.size());
+                Packed_position pos;
+                if (!group[g].position(idx, pos))
+                {
+                    cur[g][idx] = Tb::INVALID;
+                    part.win.push_back(0), part.loss.push_back(0), part.all_win.push_back(false);
+                    return;
+                }
+                expand(pos, worker, part);
+            });
+            for (auto &part : parts[g])
+                part.begin.push_back(part.next.size());
+        }
+        if (stopped())
+            return false;
+
+        // Проходы до неподвижной точки: значения прошлого прохода читаются из cur, новые пишутся в next
+        int passes = 0;
+        for (bool changed = true; changed; ++passes)
+        {
+            vector<vector<uint8_t>> next = cur;
+            vector<char> thread_changed(threads, 0);
+            for (size_t g = 0; g < group.size(); ++g)
+            {
+                run_parallel(group[g], [&](const unsigned t, const uint64_t idx, Move_gen &) {
+                    if (cur[g][idx] != Tb::DRAW)
+                        return;
+                    const uint8_t v = decide(parts[g][t], idx / threads, cur);
+                    if (v != Tb::DRAW)
+                    {
+                        next[g][idx] = v;
+                        thread_changed[t] = 1;
+                    }
+                });
+            }
+            changed = false;
+            for (const char c : thread_changed)
+                changed |= c != 0;
+            cur = move(next);
+            if (stopped())
+                return false;
+        }
+
+        for (size_t g = 0; g < group.size(); ++g)
+        {
+            solved[group[g]] = move(cur[g]);
+            if (verbose)
+                report(group[g], passes, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        return true;
+    }
+
+    const vector<uint8_t> &values(const Tb_material &m) const
+    {
+        return solved.at(m);
+    }
+
+  private:
+    // Ходы позиций группы, которые обрабатывает один поток (позиции idx = t, t + threads, ...).
+    // Для k-й позиции потока: ходы внутри группы — next[begin[k] .. begin[k + 1]) (старший бит — класс
+    // в группе), итог ходов в решённые классы — win (кратчайший выигрыш, Max_distance + 1 — нет),
+    // loss (самый долгий проигрыш) и all_win (все такие ходы ведут в выигрыш соперника).
+    struct Part
+    {
+        vector<uint64_t> begin;
+        vector<uint32_t> next;
+        vector<uint8_t> win, loss;
+        vector<bool> all_win;
+    };
+
+    static const uint32_t Flip_bit = 1u << 31;
+
+    // Перебирает ходы позиции pos с ходом белых и записывает их в part
+    void expand(const Packed_position &pos, Move_gen &worker, Part &part) const
+    {
+        const auto mtx = unpack(pos);
+        int best_win = Tb::Max_distance + 1, longest_loss = 0;
+        bool all_win = true; // ходов нет вовсе — проигрыш за 0 полуходов
+        for (const auto &chain : worker.find_full_turns(mtx, false))
+        {
+            auto mtx2 = mtx;
+            for (const auto &turn : chain)
+                mtx2 = worker.make_turn(mtx2, turn);
+            // После хода белых ходят чёрные: переставляем цвета, чтобы снова ходили белые
+            const Packed_position next = canonical(pack(mtx2), true);
+            const Tb_material nm = Tb_material::of(next);
+            if (nm == group[0] || (group.size() > 1 && nm == group[1]))
+            {
+                part.next.push_back(uint32_t(nm.index(next)) | (nm == group[0] ? 0 : Flip_bit));
+                continue;
+            }
+
+            // У соперника не осталось фигур — он проиграл
+            const uint8_t v = nm.wm + nm.wk == 0 ? Tb::loss(0) : solved.at(nm)[nm.index(next)];
+            add(v, best_win, longest_loss, all_win);
+        }
+        part.win.push_back(uint8_t(best_win));
+        part.loss.push_back(uint8_t(longest_loss));
+        part.all_win.push_back(all_win);
+    }
+
+    // Значение k-й позиции потока по значениям позиций после ходов; DRAW — пока неизвестно
+    uint8_t decide(const Part &part, const uint64_t k, const vector<vector<uint8_t>> &cur) const
+    {
+        int best_win = part.win[k], longest_loss = part.loss[k];
+        bool all_win = part.all_win[k];
+        for (uint64_t i = part.begin[k]; i < part.begin[k + 1]; ++i)
+        {
+            const uint32_t s = part.next[i];
+            add(cur[(s & Flip_bit) ? 1 : 0][s & ~Flip_bit], best_win, longest_loss, all_win);
+        }
+        if (best_win <= Tb::Max_distance)
+            return Tb::win(best_win);
+        if (all_win)
+            return Tb::loss(longest_loss);
+        return Tb::DRAW;
+    }
+
+    // Учитывает ход в позицию со значением v (для соперника)
+    static void add(const uint8_t v, int &best_win, int &longest_loss, bool &all_win)
+    {
+        if (Tb::is_loss(v))
+            best_win = min(best_win, Tb::distance(v) + 1);
+        else if (Tb::is_win(v))
+            longest_loss = max(longest_loss, Tb::distance(v) + 1);
+        else
+            all_win = false;
+    }
+
+    // Вызывает f(поток, номер, генератор ходов потока) для всех номеров класса c в threads потоках.
+    // Номера чередуются между потоками (поток t получает t, t + threads, ...), у каждого потока своя копия Logic.
+    template <class F> void run_parallel(const Tb_material &c, F f)
+    {
+        const uint64_t n = c.size();
+        auto work = [&](const unsigned t) {
+            Move_gen worker(logic);
+            for (uint64_t idx = t; idx < n && !stopped(); idx += threads)
+                f(t, idx, worker);
+        };
+        vector<thread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+            pool.emplace_back(work, t);
+        work(0);
+        for (auto &th : pool)
+            th.join();
+    }
+
+    bool stopped() const
+    {
+        return stop && stop->load(memory_order_relaxed);
+    }
+
+    void report(const Tb_material &c, const int passes, const double seconds) const
+    {
+        uint64_t wins = 0, draws = 0, losses = 0;
+        for (const uint8_t v : solved.at(c))
+        {
+            wins += Tb::is_win(v);
+            losses += Tb::is_loss(v);
+            draws += v == Tb::DRAW;
+        }
+        printf("%s: %llu positions, win %llu, draw %llu, loss %llu, %d passes, %.1f s\n", c.name().c_str(),
+               (unsigned long long)(wins + draws + losses), (unsigned long long)wins, (unsigned long long)draws,
+               (unsigned long long)losses, passes, seconds);
+        fflush(stdout);
+    }
+
+    const Move_gen &logic;
+    unsigned threads;
+    const atomic<bool> *stop;
+    map<Tb_material, vector<uint8_t>> solved;
+
+    // Решаемые вместе классы: класс и класс с переставленными цветами (если он другой)
+    vector<Tb_material> group;
+};
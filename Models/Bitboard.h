@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "Cpu_features.h"
+#include "Move.h"
+
+using namespace std;
+
+// Битовые доски: 32 тёмные клетки доски 8x8, клетка (i, j) — бит i * 4 + j / 2.
+// Используются компактными представлениями позиций (оценки по шаблонам, пакетная оценка, базы).
+
+// Номер бита тёмной клетки (i, j)
+inline int square_of(const POS_T i, const POS_T j)
+{
+    return i * 4 + j / 2;
+}
+
+// Строка и столбец клетки по номеру бита
+inline POS_T row_of(const int sq)
+{
+    return POS_T(sq / 4);
+}
+
+inline POS_T col_of(const int sq)
+{
+    return POS_T(sq % 4 * 2 + 1 - sq / 4 % 2);
+}
+
+inline int popcount32(const uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    uint32_t v = x - ((x >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return int((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+// Параллельное извлечение битов: биты x под единицами mask, сжатые в младшие разряды.
+// С BMI2 — одна инструкция PEXT, иначе цикл по битам маски.
+inline uint32_t pext32(const uint32_t x, uint32_t mask)
+{
+#if defined(__BMI2__)
+    return _pext_u32(x, mask);
+#else
+    uint32_t res = 0;
+    for (uint32_t bit = 1; mask; bit <<= 1)
+    {
+        if (x & mask & (0 - mask))
+            res |= bit;
+        mask &= mask - 1;
+    }
+    return res;
+#endif
+}
+
+#if CPU_DISPATCH_X86 || defined(_M_X64)
+// PEXT для ядер, выбираемых при запуске (Cpu_features::use_bmi2): собирается под BMI2 независимо от флагов сборки
+CPU_TARGET("bmi2") inline uint32_t pext32_bmi2(const uint32_t x, const uint32_t mask)
+{
+    return _pext_u32(x, mask);
+}
+#endif
+
+// Упакованная позиция для пакетной оценки и хранения: битовые доски фигур по типам,
+// bb[piece - 1] — фигуры piece (белые шашки, чёрные шашки, белые дамки, чёрные дамки).
+struct Packed_position
+{
+    uint32_t bb[4] = {0, 0, 0, 0};
+};
+
+inline Packed_position pack(const vector<vector<POS_T>> &mtx)
+{
+    Packed_position res;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+        for (POS_T j = 0; j < 8; ++j)
+        {
+            if (mtx[i][j])
+                res.bb[mtx[i][j] - 1] |= 1u << square_of(i, j);
+        }
+    }
+    return res;
+}
+
+inline vector<vector<POS_T>> unpack(const Packed_position &pos)
+{
+    vector<vector<POS_T>> mtx(8, vector<POS_T>(8, 0));
+    for (int p = 0; p < 4; ++p)
+    {
+        for (uint32_t b = pos.bb[p]; b; b &= b - 1)
+        {
+            const int sq = popcount32((b & (0 - b)) - 1);
+            mtx[row_of(sq)][col_of(sq)] = POS_T(p + 1);
+        }
+    }
+    return mtx;
+}
+
+// Разворот 32 бит: клетка sq переходит в 31 - sq, то есть доска поворачивается на 180°
+inline uint32_t reverse32(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Обмен цветов с поворотом доски на 180°: белые становятся чёрными и наоборот, направления
+// движения шашек сохраняются, поэтому позиция с ходом белых переходит в равноценную позицию с ходом чёрных.
+// Это единственная симметрия доски, переводящая тёмные клетки в тёмные с учётом направления шашек
+// (зеркальное отражение переводит их в светлые).
+inline Packed_position flip_colors(const Packed_position &pos)
+{
+    Packed_position res;
+    res.bb[0] = reverse32(pos.bb[1]);
+    res.bb[1] = reverse32(pos.bb[0]);
+    res.bb[2] = reverse32(pos.bb[3]);
+    res.bb[3] = reverse32(pos.bb[2]);
+    return res;
+}
+
+// Каноническая форма позиции pos, где ходит color (0 — белые): та же позиция с ходом белых.
+// Позиция и её отражение flip_colors с ходом другой стороны имеют одну каноническую форму, поэтому
+// хранилища, проиндексированные ею (базы, книга), хранят каждую пару равноценных позиций один раз.
+inline Packed_position canonical(const Packed_position &pos, const bool color)
+{
+    return color ? flip_colors(pos) : pos;
+}
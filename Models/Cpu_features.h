@@ -0,0 +1,99 @@
+#pragma once
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// GCC/Clang на x86: ядра для новых наборов инструкций собираются в том же бинарнике
+// с атрибутом target и выбираются при запуске, базовая сборка остаётся совместимой со старыми процессорами.
+#define CPU_DISPATCH_X86 1
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#define CPU_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define CPU_DISPATCH_X86 0
+#define CPU_TARGET(isa)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CPU_FORCE_INLINE __forceinline
+#else
+#define CPU_FORCE_INLINE inline
+#endif
+#endif
+
+#if defined(__linux__) && (defined(__aarch64__) || defined(__arm__))
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+using namespace std;
+
+// Возможности процессора, определённые один раз при первом обращении.
+// По ним горячие ядра (оценки по шаблонам, нейросеть, пакетная оценка) выбирают реализацию:
+// на старом процессоре — переносимую, на новом — с BMI2/AVX2, без SIGILL и без медленного кода.
+struct Cpu_features
+{
+    bool popcnt = false; // x86 POPCNT
+    bool bmi2 = false;   // x86 BMI2 (PEXT)
+    bool avx2 = false;   // x86 AVX2
+    bool neon = false;   // ARM NEON / ASIMD
+
+    static const Cpu_features &get()
+    {
+        static const Cpu_features f = detect();
+        return f;
+    }
+
+    // Использовать ли ядра с PEXT: процессор умеет BMI2, и intrinsic доступен в этой сборке
+    bool use_bmi2() const
+    {
+#if CPU_DISPATCH_X86 || defined(_M_X64)
+        return bmi2;
+#else
+        return false;
+#endif
+    }
+
+    // Использовать ли ядра, собранные под AVX2 (только GCC/Clang: MSVC не собирает функции под другой набор)
+    bool use_avx2() const
+    {
+        return CPU_DISPATCH_X86 && avx2;
+    }
+
+    string to_string() const
+    {
+        string res;
+        res += popcnt ? " popcnt" : "";
+        res += bmi2 ? " bmi2" : "";
+        res += avx2 ? " avx2" : "";
+        res += neon ? " neon" : "";
+        return res.empty() ? "none" : res.substr(1);
+    }
+
+  private:
+    static Cpu_features detect()
+    {
+        Cpu_features f;
+#if CPU_DISPATCH_X86
+        __builtin_cpu_init();
+        f.popcnt = __builtin_cpu_supports("popcnt");
+        f.bmi2 = __builtin_cpu_supports("bmi2");
+        f.avx2 = __builtin_cpu_supports("avx2");
+#elif defined(_M_X64)
+        int regs[4];
+        __cpuid(regs, 1);
+        f.popcnt = (regs[2] >> 23) & 1;
+        const bool osxsave = (regs[2] >> 27) & 1, avx = (regs[2] >> 28) & 1;
+        __cpuidex(regs, 7, 0);
+        f.bmi2 = (regs[1] >> 8) & 1;
+        // AVX2 можно использовать, только если ОС сохраняет регистры YMM
+        f.avx2 = ((regs[1] >> 5) & 1) && osxsave && avx && (_xgetbv(0) & 6) == 6;
+#elif defined(__aarch64__)
+        f.neon = true; // ASIMD обязателен для AArch64
+#if defined(__linux__)
+        f.neon = (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#endif
+#elif defined(__linux__) && defined(__arm__)
+        f.neon = (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+        return f;
+    }
+};
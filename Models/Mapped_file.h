@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Файл, отображённый в память только для чтения (mmap / MapViewOfFile).
+// Открытие почти ничего не стоит: страницы читаются с диска при первом обращении к ним
+// и вытесняются системой при нехватке памяти, поэтому большие файлы баз не загружаются целиком.
+class Mapped_file
+{
+  public:
+    Mapped_file() = default;
+    Mapped_file(const Mapped_file &) = delete;
+    Mapped_file &operator=(const Mapped_file &) = delete;
+
+    ~Mapped_file()
+    {
+        close();
+    }
+
+    // Отображает файл path; false, если файла нет, он пустой или отобразить его не удалось
+    bool open(const string &path)
+    {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+            return close(), false;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return close(), false;
+        const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+            return close(), false;
+        ptr = static_cast<const uint8_t *>(view);
+        len = size_t(file_size.QuadPart);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // отображение остаётся действительным и без дескриптора
+        if (view == MAP_FAILED)
+            return false;
+        ptr = static_cast<const uint8_t *>(view);
+        len = size_t(st.st_size);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (ptr)
+            UnmapViewOfFile(ptr);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr)
+            munmap(const_cast<uint8_t *>(ptr), len);
+#endif
+        ptr = nullptr;
+        len = 0;
+    }
+
+    const uint8_t *data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return len;
+    }
+
+  private:
+    const uint8_t *ptr = nullptr;
+    size_t len = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
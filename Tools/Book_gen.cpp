@@ -0,0 +1,238 @@
+// Утилита построения дебютной книги (статистика партий — Game/Book_builder.h, формат книги — Game/Book.h).
+// Запуск из корня проекта (нужен settings.json):
+//   Book_gen selfplay <партий> <файл партий> [уровень = 4] [потоки] [случайных полуходов = 6]
+//   Book_gen build <книга> <файл партий>... [--plies 20] [--min-games 3] [--buffer-mb 256]
+//                                            [--verify <уровень>] [--margin 50] [--threads N]
+#define SDL_MAIN_HANDLED
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Board.h"
+#include "../Game/Book_builder.h"
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+#include "../Game/Notation.h"
+
+using namespace std;
+
+// Партии бота с самим собой на уровне level. Первые random_plies полуходов случайны, иначе партии
+// повторялись бы; партия без ходов у ходящего — его поражение, после "MaxNumTurns" полуходов или по
+// правилам (повторение, "KingMovesDraw") — ничья, как в Game.
+int self_play(const int count, const string &path, const int level, const unsigned threads, const int random_plies)
+{
+    Config config;
+    const int max_turns = config("Game", "MaxNumTurns");
+    ofstream fout(path, ios::app);
+    if (!fout)
+    {
+        printf("cannot write %s\n", path.c_str());
+        return 1;
+    }
+
+    mutex out_lock;
+    atomic<int> next{0};
+    const unsigned seed = unsigned(time(0));
+    auto work = [&]() {
+        Board board;
+        Logic logic(&board, &config);
+        logic.set_book(nullptr);
+        logic.set_level(level);
+        for (int g; (g = next++) < count;)
+        {
+            mt19937 rng(seed + unsigned(g));
+            auto mtx = Board::start_mtx();
+            bool color = false;
+            string record;
+            int result = 0;
+            vector<vector<vector<POS_T>>> positions;
+            for (int ply = 0; ply < max_turns; ++ply)
+            {
+                // История — для правил ничьей и числа оставшихся полуходов в поиске
+                positions.push_back(mtx);
+                logic.set_history(positions);
+                if (logic.is_rule_draw())
+                    break;
+                const auto chains = logic.find_full_turns(mtx, color);
+                if (chains.empty())
+                {
+                    result = color ? 1 : -1;
+                    break;
+                }
+                vector<move_pos> chain = ply < random_plies ? chains[rng() % chains.size()]
+                                                            : logic.search_position(mtx, color);
+                for (const auto &turn : chain)
+                    mtx = logic.make_turn(mtx, turn);
+                record += Notation::move_string(chain) + " ";
+                color = !color;
+            }
+            record += result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2";
+
+            lock_guard<mutex> lock(out_lock);
+            fout << record << "\n";
+            printf("game %d: %s\n", g + 1, result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2");
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(work);
+    work();
+    for (auto &th : pool)
+        th.join();
+    return 0;
+}
+
+// Проверка ходов книги поиском уровня level (не меньше 1): ход остаётся, если его оценка не хуже лучшего
+// хода позиции больше чем на margin. Позиция после хода ищется уровнем level - 1, так что оценки хода
+// и лучшего хода получены на одинаковой глубине от позиции книги (с одной чётностью).
+// Позиции делятся между threads потоками, у каждого свой Logic.
+vector<Book_record> verify(const vector<Book_record> &records, const int level, const int margin,
+                           const unsigned threads)
+{
+    // Начала групп ходов одной позиции (записи отсортированы по ключу)
+    vector<size_t> groups;
+    for (size_t k = 0; k < records.size(); ++k)
+        if (k == 0 || records[k].key != records[k - 1].key)
+            groups.push_back(k);
+    groups.push_back(records.size());
+
+    Config config;
+    vector<char> keep(records.size(), 0);
+    atomic<size_t> next{0}, done{0};
+    auto work = [&]() {
+        Board board;
+        Logic logic(&board, &config);
+        logic.set_book(nullptr);
+        for (size_t g; (g = next++) + 1 < groups.size();)
+        {
+            // Позиции книги хранятся в канонической форме — ходят белые
+            const auto mtx = unpack(records[groups[g]].pos);
+            const bool color = false;
+            logic.set_level(level);
+            logic.search_position(mtx, color);
+            const SCORE_T best = logic.score;
+            logic.set_level(level - 1);
+            for (const auto &chain : logic.find_full_turns(mtx, color))
+            {
+                auto mtx2 = mtx;
+                for (const auto &turn : chain)
+                    mtx2 = logic.make_turn(mtx2, turn);
+                const uint64_t next_key = Zobrist::canonical_key(mtx2, !color);
+                for (size_t k = groups[g]; k < groups[g + 1]; ++k)
+                {
+                    if (records[k].next_key != next_key)
+                        continue;
+                    // Ход, после которого у соперника нет ходов, — выигрыш
+                    const bool over = logic.search_position(mtx2, !color).empty();
+                    keep[k] = over || -logic.score >= best - margin;
+                }
+            }
+            if (++done % 1000 == 0)
+                printf("verified %zu / %zu positions\n", size_t(done), groups.size() - 1);
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(work);
+    work();
+    for (auto &th : pool)
+        th.join();
+
+    vector<Book_record> res;
+    for (size_t k = 0; k < records.size(); ++k)
+        if (keep[k])
+            res.push_back(records[k]);
+    return res;
+}
+
+int build(const string &book_path, const vector<string> &inputs, const int plies, const uint32_t min_games,
+          const size_t buffer_mb, const int verify_level, const int margin, const unsigned threads)
+{
+    Config config;
+    Board board;
+    Logic logic(&board, &config);
+    logic.set_book(nullptr);
+
+    Book_builder<Logic> builder(logic, book_path, buffer_mb, plies);
+    for (const auto &path : inputs)
+    {
+        ifstream fin(path);
+        if (!fin)
+        {
+            printf("cannot read %s\n", path.c_str());
+            return 1;
+        }
+        builder.add_games(fin);
+        printf("%s: %llu games, %llu rejected\n", path.c_str(), (unsigned long long)builder.games,
+               (unsigned long long)builder.bad_games);
+    }
+
+    auto records = builder.merge(min_games);
+    printf("%zu moves played at least %u times\n", records.size(), min_games);
+    if (verify_level > 0)
+    {
+        const auto start = chrono::steady_clock::now();
+        records = verify(records, verify_level, margin, threads);
+        printf("%zu moves kept after verification (%.1f s)\n", records.size(),
+               chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+    if (!Book::save(book_path, Book_builder<Logic>::entries(records)))
+    {
+        printf("cannot write %s\n", book_path.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const string mode = argc > 1 ? argv[1] : "";
+    const unsigned cores = max(1u, thread::hardware_concurrency());
+    if (mode == "selfplay" && argc > 3)
+    {
+        return self_play(atoi(argv[2]), argv[3], argc > 4 ? atoi(argv[4]) : 4,
+                         argc > 5 ? unsigned(max(1, atoi(argv[5]))) : cores, argc > 6 ? atoi(argv[6]) : 6);
+    }
+    if (mode == "build" && argc > 3)
+    {
+        vector<string> inputs;
+        int plies = 20, verify_level = 0, margin = 50;
+        uint32_t min_games = 3;
+        size_t buffer_mb = 256;
+        unsigned threads = cores;
+        for (int i = 3; i < argc; ++i)
+        {
+            const string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--plies" && has_value)
+                plies = atoi(argv[++i]);
+            else if (arg == "--min-games" && has_value)
+                min_games = uint32_t(atoi(argv[++i]));
+            else if (arg == "--buffer-mb" && has_value)
+                buffer_mb = size_t(atoi(argv[++i]));
+            else if (arg == "--verify" && has_value)
+                verify_level = atoi(argv[++i]);
+            else if (arg == "--margin" && has_value)
+                margin = atoi(argv[++i]);
+            else if (arg == "--threads" && has_value)
+                threads = unsigned(max(1, atoi(argv[++i])));
+            else
+                inputs.push_back(arg);
+        }
+        return build(argv[2], inputs, plies, min_games, buffer_mb, verify_level, margin, threads);
+    }
+    printf("usage:\n"
+           "  Book_gen selfplay <games> <games file> [level = 4] [threads] [random plies = 6]\n"
+           "  Book_gen build <book> <games file>... [--plies 20] [--min-games 3] [--buffer-mb 256]\n"
+           "                                        [--verify <level>] [--margin 50] [--threads N]\n");
+    return 1;
+}
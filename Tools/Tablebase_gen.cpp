@@ -0,0 +1,86 @@
+// Утилита построения эндшпильных баз (алгоритм — Game/Tablebase_gen.h, формат файлов — Game/Tablebase.h).
+// Запуск из корня проекта (нужен settings.json): Tablebase_gen [число фигур = 4] [потоки] [каталог = Tablebases]
+// Попутно сверяет распознаватели эндшпилей (Game/Endgame.h) с построенными значениями: при расхождении
+// печатает позицию и завершается с кодом 2.
+#define SDL_MAIN_HANDLED
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "../Game/Board.h"
+#include "../Game/Config.h"
+#include "../Game/Endgame.h"
+#include "../Game/Logic.h"
+#include "../Game/Notation.h"
+#include "../Game/Tablebase_gen.h"
+
+using namespace std;
+
+// Сверяет распознаватели с базой класса m: каждую позицию с ходом белых и её отражение с ходом чёрных,
+// в которых нет взятий у ходящей стороны (так распознаватели вызывает поиск). Ничья должна быть ничьей,
+// граница победы — победой не дольше KNOWN_WIN_PLIES полуходов. Возвращает число расхождений.
+uint64_t check_endgame(Logic &logic, const Tb_material &m, const vector<uint8_t> &values)
+{
+    uint64_t recognized = 0, wrong = 0;
+    for (uint64_t idx = 0; idx < values.size(); ++idx)
+    {
+        Packed_position pos;
+        if (values[idx] == Tb::INVALID || !m.position(idx, pos))
+            continue;
+        for (const bool color : {false, true})
+        {
+            const auto mtx = unpack(canonical(pos, color));
+            // Взятие обязательно, поэтому если первый ход со взятием, то и все
+            const auto full = logic.find_full_turns(mtx, color);
+            if (full.empty() || full[0][0].xb != -1)
+                continue;
+            const auto known = Endgame::probe(mtx, color);
+            if (known.bound == Search_memory::NONE)
+                continue;
+            ++recognized;
+            // Значение базы — для ходящей стороны, граница распознавателя — для белых
+            const uint8_t v = values[idx];
+            const bool white_wins = color ? Tb::is_loss(v) : Tb::is_win(v);
+            const bool black_wins = color ? Tb::is_win(v) : Tb::is_loss(v);
+            bool ok = known.bound == Search_memory::EXACT ? v == Tb::DRAW
+                      : known.bound == Search_memory::LOWER ? white_wins
+                                                            : black_wins;
+            ok = ok && (known.bound == Search_memory::EXACT || Tb::distance(v) <= KNOWN_WIN_PLIES);
+            if (!ok && wrong++ == 0)
+                printf("%s: recognizer disagrees with the tablebase in %s\n", m.name().c_str(),
+                       Notation::position_string(mtx, color).c_str());
+        }
+    }
+    if (recognized)
+        printf("%s: %llu positions recognized, %llu wrong\n", m.name().c_str(), (unsigned long long)recognized,
+               (unsigned long long)wrong);
+    return wrong;
+}
+
+int main(int argc, char *argv[])
+{
+    const int max_pieces = argc > 1 ? atoi(argv[1]) : 4;
+    const unsigned threads = argc > 2 ? unsigned(atoi(argv[2])) : thread::hardware_concurrency();
+    const string dir = argc > 3 ? argv[3] : "Tablebases";
+
+    Config config;
+    Board board;
+    Logic logic(&board, &config);
+    logic.set_tablebase(nullptr);
+    Tablebase_generator<Logic> gen(logic, threads);
+    gen.verbose = true;
+
+    uint64_t wrong = 0;
+    for (const auto &m : Tb_material::classes(max_pieces))
+    {
+        gen.solve(m);
+        wrong += check_endgame(logic, m, gen.values(m));
+        if (!Tb_file::save(Tb_file::file_name(dir, m), m, gen.values(m)))
+        {
+            printf("cannot write %s (does the directory exist?)\n", Tb_file::file_name(dir, m).c_str());
+            return 1;
+        }
+    }
+    return wrong ? 2 : 0;
+}
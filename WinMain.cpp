@@ -1,7 +1,58 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
 #include "Game/Game.h"
+#include "Game/Notation.h"
+
+// Доказывает результат позиции и печатает отчёт решателя (Logic::solve).
+// plies < 0 — столько полуходов, сколько разрешает "MaxNumTurns".
+int solve_position(const std::string &text, int plies, const unsigned long long max_nodes)
+{
+    std::vector<std::vector<POS_T>> mtx;
+    bool color;
+    if (!Notation::parse_position(text, mtx, color))
+    {
+        std::cout << "bad position: " << text << "\n";
+        return 1;
+    }
+    Config config;
+    Board board;
+    Logic logic(&board, &config);
+    if (plies < 0)
+        plies = config("Game", "MaxNumTurns");
+
+    const auto rep = logic.solve(mtx, color, plies, size_t(config("Bot", "SolverMB")), max_nodes);
+    const char *names[] = {"win", "loss", "draw", "unknown (node limit reached)"};
+    const int king_moves_draw = config("Game", "KingMovesDraw");
+    std::cout << "position: " << Notation::position_string(mtx, color) << ", " << plies << " plies to the draw\n";
+    if (king_moves_draw)
+        std::cout << "king-move draw after " << king_moves_draw << " plies without men moves or captures\n";
+    std::cout << "result for the side to move: " << names[int(rep.result)]
+              << " (threefold repetition is not modelled)\n"
+              << "nodes: " << rep.nodes << ", proof tree: " << rep.proof_size << " positions\n"
+              << "table: " << rep.tt_used << "/" << rep.tt_size << " entries\n"
+              << "time: " << rep.seconds << " s\n";
+    return 0;
+}
 
 int WinMain(int argc, char* argv[]) 
 {
+    // Диагностика: какие реализации ядер поиска выбраны для этого процессора
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--cpu-features")
+        {
+            std::cout << Logic::cpu_report();
+            return 0;
+        }
+        // Решатель: --solve "<позиция>" [полуходов до ничьей] [предел узлов], позиция — Game/Notation.h
+        if (std::string(argv[i]) == "--solve" && i + 1 < argc)
+            return solve_position(argv[i + 1], i + 2 < argc ? std::atoi(argv[i + 2]) : -1,
+                                  i + 3 < argc ? std::strtoull(argv[i + 3], nullptr, 10) : 0);
+    }
+
     Game g;
     g.play();
 